@@ -0,0 +1,36 @@
+/*
+ * bench.h - 基准测试程序共用的辅助函数。
+ * 由 reader.c 和 suite.c 直接包含，函数均为 static，不单独编译。
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* 单调时钟的当前时间，以秒为单位。 */
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+ * 生成约 1 MiB 的读取器输入：定义、注释和字符串交替出现。
+ * "调用者"负责使用 `free` 释放返回的缓冲区。
+ */
+static char *generate(void) {
+  size_t cap = 1 << 21;
+  size_t len = 0;
+  char *s = malloc(cap);
+  for (int i = 0; len < (1 << 20); i++) {
+    len += snprintf(s + len, cap - len,
+                    "; record %d\n"
+                    "(def {rec-%d} {%d -%d \"s%d\\t\" (+ %d 1) {a b}})\n",
+                    i, i, i, i * 7, i, i);
+  }
+  return s;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * reader.c - 比较手写读取器与 mpc 语法解析器的读取速度。
+ * 用法: bench-reader [文件] [重复次数]
+ * 不给出文件时生成一段约 1 MiB 的数据作为输入。
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "local-include/common.h"
+#include "local-include/lread.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+#include <mpc.h>
+
+static char *slurp(const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *s = malloc(len + 1);
+  s[fread(s, 1, len, f)] = '\0';
+  fclose(f);
+  return s;
+}
+
+int main(int argc, char **argv) {
+  char *src = argc > 1 ? slurp(argv[1]) : generate();
+  int reps = argc > 2 ? atoi(argv[2]) : 20;
+  if (!src) {
+    fprintf(stderr, "bench-reader: cannot read %s\n", argv[1]);
+    return 1;
+  }
+  size_t len = strlen(src);
+  parser_init();
+
+  double t = now();
+  for (int i = 0; i < reps; i++) {
+    lval_del(lread_all("bench", src, len));
+  }
+  double hand = now() - t;
+
+  t = now();
+  for (int i = 0; i < reps; i++) {
+    mpc_result_t r;
+    if (mpc_parse("bench", src, Lispy, &r)) {
+      lval_del(lval_read(r.output));
+      mpc_ast_delete(r.output);
+    } else {
+      mpc_err_delete(r.error);
+    }
+  }
+  double mpc = now() - t;
+
+  double mb = (double)len * reps / (1 << 20);
+  printf("input  %.2f MiB x %d\n", (double)len / (1 << 20), reps);
+  printf("lread  %8.3f s  %8.1f MiB/s\n", hand, mb / hand);
+  printf("mpc    %8.3f s  %8.1f MiB/s\n", mpc, mb / mpc);
+  printf("speedup %.1fx\n", mpc / hand);
+
+  free(src);
+  parser_quit();
+  return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * suite.c - 解释器的基准测试集。
+ * 用法: bench-suite [-o 输出文件] [-b 基准文件] [-t 容差百分比] [用例...]
+ * 需要在仓库根目录下运行，以便加载 lispy/prelude.lspy。
+ *
+ * 每个用例在单独的子进程中运行：先加载 prelude 并执行用例的准备代码，
+ * 再按约 50ms 一批重复执行用例，取最快一批的平均耗时。
+ * 结果以 JSON 输出，每个用例一行，包括每次操作的耗时（ns_per_op）、
+ * 分配器的分配次数（allocs_per_op）和子进程的峰值驻留内存（peak_rss_kb）。
+ * 给出基准文件时逐项比较，耗时或峰值内存超出容差（默认 10%）、
+ * 或分配次数增加的用例视为回归，此时以退出码 1 结束。
+ * 耗时与机器有关，基准文件应在同一台机器上用 `make bench-baseline` 生成。
+ * glibc 会随大块内存的释放调高 mmap 阈值，使同一用例的峰值内存在两次运行间
+ * 相差数 MB，因此子进程固定该阈值（相当于设置 MALLOC_MMAP_THRESHOLD_）。
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "bench.h"
+#include "local-include/common.h"
+#include "local-include/lmem.h"
+#include "local-include/lread.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+#define BENCH_PRELUDE "lispy/prelude.lspy"
+#define BENCH_BATCH 0.05
+#define BENCH_BATCHES 5
+#define BENCH_GLOBALS 10000
+#define BENCH_RSS_SLACK 1024
+#define BENCH_MMAP_THRESHOLD (128 * 1024)
+
+typedef struct {
+  const char *name;
+  const char *setup;
+  const char *body;
+  int (*prepare)(lenv *e);
+  void (*run)(void);
+} bench_case;
+
+typedef struct {
+  char name[64];
+  double ns;
+  double allocs;
+  long rss;
+} bench_result;
+
+static char *parser_input;
+
+static int bench_eval(lenv *e, const char *src);
+static int bench_parser_input(lenv *e);
+static int bench_globals(lenv *e);
+
+static void bench_parse(void) {
+  lval_del(lread_all("bench", parser_input, strlen(parser_input)));
+}
+
+static const bench_case cases[] = {
+    {"prelude", NULL, "(load \"" BENCH_PRELUDE "\")", NULL, NULL},
+    {"fib",
+     "(fun {fib n} {if (< n 2) {n} {+ (fib (- n 1)) (fib (- n 2))}})",
+     "(fib 20)", NULL, NULL},
+    {"map-filter-foldl", "(def {xs} (vec-list (vec-range 10000)))",
+     "(foldl + 0 (filter (\\ {x} {> x 5000}) (map (\\ {x} {* x 2}) xs)))",
+     NULL, NULL},
+    {"deep-recursion",
+     "(fun {depth n} {if (== n 0) {0} {+ 1 (depth (- n 1))}})",
+     "(depth 2000)", NULL, NULL},
+    {"tail-select",
+     "(fun {down n} {select {(== n 0) 0} {otherwise (down (- n 1))}}) "
+     "(fun {down-case n} {case (== n 0) {1 0} {0 (down-case (- n 1))}})",
+     "(+ (down 100000) (down-case 100000))", NULL, NULL},
+    {"print-strings", NULL,
+     "(print \"alpha\\tbeta\" \"a \\\"quoted\\\" string\" \"line\\n\" "
+     "\"the quick brown fox jumps over the lazy dog\" {\"x\" \"y\" \"z\"})",
+     NULL, NULL},
+    {"parser", NULL, NULL, bench_parser_input, bench_parse},
+    {"global-lookup", NULL, "(list g0 g2500 g5000 g7500 g9999)", bench_globals,
+     NULL},
+};
+#define BENCH_CASES ((int)(sizeof cases / sizeof cases[0]))
+
+static int bench_parser_input(lenv *e) {
+  parser_input = generate();
+  return 1;
+}
+
+/* (def {g0 g1 ...} 0 1 ...), making the global environment fat. */
+static int bench_globals(lenv *e) {
+  size_t cap = BENCH_GLOBALS * 16 + 64;
+  char *s = malloc(cap);
+  size_t len = snprintf(s, cap, "(def {");
+  for (int i = 0; i < BENCH_GLOBALS; i++) {
+    len += snprintf(s + len, cap - len, i ? " g%d" : "g%d", i);
+  }
+  len += snprintf(s + len, cap - len, "}");
+  for (int i = 0; i < BENCH_GLOBALS; i++) {
+    len += snprintf(s + len, cap - len, " %d", i);
+  }
+  snprintf(s + len, cap - len, ")");
+  int ok = bench_eval(e, s);
+  free(s);
+  return ok;
+}
+
+/* Evaluate every top-level expression of `src`, failing on an error. */
+static int bench_eval(lenv *e, const char *src) {
+  lval *all = parse_read("bench", src);
+  if (all->type == LVAL_ERR) {
+    lval_println(all);
+    lval_del(all);
+    return 0;
+  }
+  while (all->count) {
+    lval *x = lval_eval(e, lval_pop(all, 0));
+    if (x->type == LVAL_ERR) {
+      lval_println(x);
+      lval_del(x);
+      lval_del(all);
+      return 0;
+    }
+    lval_del(x);
+  }
+  lval_del(all);
+  return 1;
+}
+
+static double bench_batch(lenv *e, const bench_case *c, lval *expr,
+                          long reps) {
+  double t = now();
+  for (long i = 0; i < reps; i++) {
+    if (c->run) {
+      c->run();
+      continue;
+    }
+    lval *x = lval_eval(e, lval_copy(expr));
+    if (x->type == LVAL_ERR) {
+      lval_println(x);
+      exit(1);
+    }
+    lval_del(x);
+  }
+  t = now() - t;
+  lmem_reset();
+  return t;
+}
+
+/* Runs in the child process, writing "ns allocs" to `fd`. */
+static void bench_child(const bench_case *c, int fd) {
+#ifdef __GLIBC__
+  mallopt(M_MMAP_THRESHOLD, BENCH_MMAP_THRESHOLD);
+#endif
+  parser_init();
+  lenv *e = lenv_new();
+  lenv_add_builtins(e);
+  if (!bench_eval(e, "(load \"" BENCH_PRELUDE "\")")) {
+    exit(1);
+  }
+  if (c->setup && !bench_eval(e, c->setup)) {
+    exit(1);
+  }
+  if (c->prepare && !c->prepare(e)) {
+    exit(1);
+  }
+
+  lval *expr = NULL;
+  if (c->body) {
+    lval *all = parse_read("bench", c->body);
+    expr = lval_pop(all, 0);
+    lval_del(all);
+  }
+  /* Keep `print` off the terminal; results go through the pipe. */
+  if (!freopen("/dev/null", "w", stdout)) {
+    exit(1);
+  }
+
+  double once = bench_batch(e, c, expr, 1);
+  long reps = once > 0 ? BENCH_BATCH / once : 1000000;
+  reps = reps < 1 ? 1 : reps > 1000000 ? 1000000 : reps;
+
+  size_t allocs = lmem_allocs();
+  double best = -1;
+  for (int i = 0; i < BENCH_BATCHES; i++) {
+    double t = bench_batch(e, c, expr, reps);
+    best = best < 0 || t < best ? t : best;
+  }
+  allocs = lmem_allocs() - allocs;
+
+  dprintf(fd, "%.1f %.1f\n", best / reps * 1e9,
+          (double)allocs / (reps * BENCH_BATCHES));
+  exit(0);
+}
+
+static int bench_run(const bench_case *c, bench_result *r) {
+  int fds[2];
+  if (pipe(fds) < 0) {
+    return 0;
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    bench_child(c, fds[1]);
+  }
+  close(fds[1]);
+  char buf[128] = {0};
+  ssize_t n = read(fds[0], buf, sizeof buf - 1);
+  close(fds[0]);
+
+  int status;
+  struct rusage ru;
+  if (pid < 0 || wait4(pid, &status, 0, &ru) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0 || n <= 0) {
+    return 0;
+  }
+  snprintf(r->name, sizeof r->name, "%s", c->name);
+  r->rss = ru.ru_maxrss;
+  return sscanf(buf, "%lf %lf", &r->ns, &r->allocs) == 2;
+}
+
+static void bench_write(FILE *f, bench_result *rs, int n) {
+  fprintf(f, "[\n");
+  for (int i = 0; i < n; i++) {
+    fprintf(f,
+            "  {\"name\": \"%s\", \"ns_per_op\": %.1f, \"allocs_per_op\": "
+            "%.1f, \"peak_rss_kb\": %ld}%s\n",
+            rs[i].name, rs[i].ns, rs[i].allocs, rs[i].rss,
+            i + 1 < n ? "," : "");
+  }
+  fprintf(f, "]\n");
+}
+
+/* Reads a file written by bench_write; returns the number of results. */
+static int bench_read(const char *filename, bench_result *rs, int max) {
+  FILE *f = fopen(filename, "r");
+  if (!f) {
+    return -1;
+  }
+  char line[256];
+  int n = 0;
+  while (n < max && fgets(line, sizeof line, f)) {
+    bench_result *r = &rs[n];
+    if (sscanf(line,
+               " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, "
+               "\"allocs_per_op\": %lf, \"peak_rss_kb\": %ld}",
+               r->name, &r->ns, &r->allocs, &r->rss) == 4) {
+      n++;
+    }
+  }
+  fclose(f);
+  return n;
+}
+
+static double change(double now, double base) {
+  return base > 0 ? (now - base) / base * 100 : 0;
+}
+
+/* Prints the comparison; returns the number of regressions. */
+static int bench_compare(bench_result *rs, int n, bench_result *base, int nb,
+                         double tolerance) {
+  int bad = 0;
+  fprintf(stderr, "%-18s %12s %8s %12s %8s %10s %8s\n", "case", "ns/op",
+          "diff", "allocs/op", "diff", "rss kB", "diff");
+  for (int i = 0; i < n; i++) {
+    bench_result *b = NULL;
+    for (int j = 0; j < nb && !b; j++) {
+      b = strcmp(base[j].name, rs[i].name) == 0 ? &base[j] : NULL;
+    }
+    if (!b) {
+      fprintf(stderr, "%-18s %12.1f %8s %12.1f %8s %10ld %8s  (new)\n",
+              rs[i].name, rs[i].ns, "", rs[i].allocs, "", rs[i].rss, "");
+      continue;
+    }
+    double dt = change(rs[i].ns, b->ns);
+    double da = change(rs[i].allocs, b->allocs);
+    double dr = change(rs[i].rss, b->rss);
+    /* Allocation counts are deterministic, so any growth is reported; the
+     * resident size of a small process moves by a few hundred kB anyway. */
+    int slow = dt > tolerance;
+    int alloc = rs[i].allocs > b->allocs + 0.5;
+    int rss = dr > tolerance && rs[i].rss > b->rss + BENCH_RSS_SLACK;
+    fprintf(stderr,
+            "%-18s %12.1f %+7.1f%% %12.1f %+7.1f%% %10ld %+7.1f%%%s%s%s\n",
+            rs[i].name, rs[i].ns, dt, rs[i].allocs, da, rs[i].rss, dr,
+            slow ? "  SLOWER" : "", alloc ? "  MORE-ALLOCS" : "",
+            rss ? "  MORE-RSS" : "");
+    bad += slow || alloc || rss;
+  }
+  return bad;
+}
+
+int main(int argc, char **argv) {
+  const char *output = NULL;
+  const char *baseline = NULL;
+  double tolerance = 10;
+  const char *only[BENCH_CASES];
+  int nonly = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      baseline = argv[++i];
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (nonly < BENCH_CASES) {
+      only[nonly++] = argv[i];
+    }
+  }
+
+  bench_result rs[BENCH_CASES];
+  int n = 0;
+  for (int i = 0; i < BENCH_CASES; i++) {
+    int run = !nonly;
+    for (int j = 0; j < nonly; j++) {
+      run |= strcmp(only[j], cases[i].name) == 0;
+    }
+    if (!run) {
+      continue;
+    }
+    fprintf(stderr, "bench: %s\n", cases[i].name);
+    if (!bench_run(&cases[i], &rs[n])) {
+      fprintf(stderr, "bench: %s failed\n", cases[i].name);
+      return 1;
+    }
+    n++;
+  }
+
+  FILE *f = output ? fopen(output, "w") : stdout;
+  if (!f) {
+    fprintf(stderr, "bench: cannot write %s\n", output);
+    return 1;
+  }
+  bench_write(f, rs, n);
+  if (output) {
+    fclose(f);
+    fprintf(stderr, "bench: results written to %s\n", output);
+  }
+
+  if (!baseline) {
+    return 0;
+  }
+  bench_result base[64];
+  int nb = bench_read(baseline, base, 64);
+  if (nb < 0) {
+    fprintf(stderr, "bench: cannot read %s\n", baseline);
+    return 1;
+  }
+  int bad = bench_compare(rs, n, base, nb, tolerance);
+  if (bad) {
+    fprintf(stderr, "bench: %d regression(s) against %s\n", bad, baseline);
+  }
+  return bad ? 1 : 0;
+}
@@ -18,11 +18,114 @@ int parse_line(const char *line, mpc_result_t *r);
 void parse_print(mpc_result_t *r);
 void parse_delete(mpc_result_t *r);
 void parse_error(mpc_result_t *r);
+/*
+ * 读取 lisp 源代码 `s`，返回由其中所有顶层表达式组成的 S表达式。
+ * 参数 `name`: 源代码的名称，用于错误信息中的位置。
+ * 默认使用手写的读取器，不经过 mpc 语法树；语法错误时返回 LVAL_ERR。
+ * "调用方"负责使用 `lval_del` 函数释放返回的值。
+ */
+lval *parse_read(const char *name, const char *s);
+/*
+ * 读取文件 `filename` 中的全部 lisp 源代码，同 `parse_read`。
+ * 无法打开文件时返回 LVAL_ERR。
+ * "调用方"负责使用 `lval_del` 函数释放返回的值。
+ */
+lval *parse_file(const char *filename);
+/*
+ * 在环境 `e` 中加载文件 `filename`。
+ * 文件被映射到内存中，每读取一个顶层表达式就立即求值，再读取下一个，
+ * 因此内存占用与文件大小无关，求值出错时打印错误并继续。
+ * 返回: 成功时返回空的 S表达式；无法打开文件或遇到语法错误时返回 LVAL_ERR，
+ * 此时错误之前的表达式已经求值。
+ * "调用方"负责使用 `lval_del` 函数释放返回的值。
+ */
+lval *parse_load(lenv *e, const char *filename);
+/*
+ * 启用 mpc 校验模式：每段输入同时交给 mpc 语法解析器和手写读取器，
+ * 两者结果不一致时向 stderr 打印警告，并以 mpc 的结果为准。
+ * 该模式下 `parse_load` 先读取整个文件，校验后再逐个求值。
+ */
+void parse_validate(void);
+/*
+ * 依次加载命令行中给出的文件，以 "--" 开头的参数视为选项并被跳过。
+ */
 void parse_args(int argc, char **argv, lenv *e);
 void parser_quit(void);
 
 /*
- * 创建一个新的 lisp 环境。
+ * 在顶层表达式求值结束后重置分配器。
+ * 顶层表达式产生的临时值此时已全部释放，
+ * 完全空闲的 slab 会被归还给系统，只为每个尺寸类保留少量备用。
+ * 用于避免长时间运行的会话在一次分配高峰后持续占用内存。
+ */
+void lmem_reset(void);
+/*
+ * 释放分配器持有的全部 slab。
+ * 应在所有 lisp 值和环境都释放之后调用。
+ */
+void lmem_quit(void);
+
+/*
+ * 启用分代回收器，在引用计数之外用试删除查找只通过循环互相引用的对象。
+ * 当前的所有权模型不会产生循环，回收器用于衡量这类回收的开销（见 `lgc.h`），
+ * 必须在创建任何 lisp 值和环境之前调用。
+ */
+void lgc_enable(void);
+/*
+ * 打印回收器的统计信息：各代回收次数、扫描和释放的对象数，
+ * 以及暂停时间的直方图。未启用回收器时不输出任何内容。
+ */
+void lgc_report(void);
+
+/*
+ * 开始性能分析，清空之前的统计数据。
+ * 参数 `sample`: 为 1 时只按定时器采样调用栈，不统计时间，开销更低。
+ * 返回: 成功开始时返回 1；分析器已在运行时返回 0，不做任何操作。
+ */
+int lprof_start(int sample);
+/*
+ * 设置折叠栈的输出文件，默认为 "profile.folded"。
+ * 注意: 分析器不对 `filename` 拥有所有权，它必须保持有效直到报告输出。
+ */
+void lprof_output(const char *filename);
+/*
+ * 停止性能分析，打印按自身时间（采样模式下按采样数）排序的报告，
+ * 并将采样得到的折叠栈写入输出文件。分析器未在运行时不输出任何内容。
+ */
+void lprof_report(void);
+
+/*
+ * 关闭定义时优化器，此后定义的函数按原样编译，不做常量折叠、分支消除和内联，
+ * 也不检查内置函数调用的参数个数。应在加载任何文件之前调用。
+ */
+void lopt_disable(void);
+/*
+ * 启用优化器的转储模式：此后每定义一个函数，
+ * 都向 stdout 打印其函数体在优化器改写前后的样子。
+ */
+void lopt_dump(void);
+
+/*
+ * 如果退出时仍有 lisp 值或环境没有被释放，向 stderr 打印它们的数量，
+ * 以及按类型统计的存活值。应在释放全局环境之后调用。
+ * 没有引用计数无法回收的循环时，这里报告的就是泄漏。
+ */
+void lstats_report(void);
+
+/*
+ * 释放求值器的值栈。
+ * 应在所有求值结束之后调用。
+ */
+void lstack_quit(void);
+
+/*
+ * 释放符号驻留表及其中的全部符号名。
+ * 应在所有 lisp 值和环境都释放之后调用。
+ */
+void lsym_quit(void);
+
+/*
+ * 创建一个新的全局 lisp 环境。
  * "调用方"负责使用 lenv_del 函数释放返回的环境。
  */
 lenv *lenv_new(void);
@@ -33,10 +136,17 @@ lenv *lenv_new(void);
 void lenv_add_builtins(lenv *e);
 /*
  * 释放 lisp 环境 `e`。
+ * 未建立哈希索引的小环境（如函数调用的帧）连同其数组一起缓存，
+ * 供之后的 `lenv_new` 重用，因此稳定运行时调用函数不需要分配内存。
  * "调用方"在释放 lisp 环境后不应继续使用该环境。
  * 建议在释放环境后将相关指针置为 NULL。
  */
 void lenv_del(lenv *e);
+/*
+ * 释放缓存的空闲环境（见 `lenv_del`）。
+ * 应在所有环境都释放之后调用。
+ */
+void lenv_quit(void);
 
 /*
  * 将抽象语法树解析成 lisp 值。
@@ -44,7 +154,7 @@ void lenv_del(lenv *e);
  */
 lval *lval_read(mpc_ast_t *t);
 /*
- * 释放 lisp 值 `v`。
+ * 释放对 lisp 值 `v` 的一个引用，引用计数归零时释放其占用的内存。
  * "调用方"在释放 lisp 值后不应继续使用该值。
  * 建议在释放值后将相关指针置为 NULL。
  */
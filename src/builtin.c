@@ -1,10 +1,17 @@
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "local-include/common.h"
+#include "local-include/lcode.h"
 #include "local-include/lenv.h"
+#include "local-include/lmemo.h"
+#include "local-include/lprof.h"
+#include "local-include/lstack.h"
+#include "local-include/lstats.h"
 #include "local-include/lval.h"
+#include "local-include/lvec.h"
 #include <clisp.h>
 #include <mpc.h>
 
@@ -13,12 +20,7 @@ lval *builtin_head(lenv *e, lval *a) {
   LASSERT_TYPE("head", a, 0, LVAL_QEXPR);
   LASSERT_NOT_EMPTY("head", a, 0);
 
-  lval *v = lval_take(a, 0);
-
-  while (v->count > 1) {
-    lval_del(lval_pop(v, 1));
-  }
-  return v;
+  return lval_slice(lval_take(a, 0), 0, 1);
 }
 
 lval *builtin_tail(lenv *e, lval *a) {
@@ -27,23 +29,26 @@ lval *builtin_tail(lenv *e, lval *a) {
   LASSERT_NOT_EMPTY("tail", a, 0);
 
   lval *v = lval_take(a, 0);
-
-  lval_del(lval_pop(v, 0));
-  return v;
+  return lval_slice(v, 1, v->count - 1);
 }
 
 lval *builtin_list(lenv *e, lval *a) {
+  a = lval_mut(a);
   a->type = LVAL_QEXPR;
   return a;
 }
 
-lval *builtin_eval(lenv *e, lval *a) {
+lval *builtin_eval_expr(lenv *e, lval *a) {
   LASSERT_NUM("eval", a, 1);
   LASSERT_TYPE("eval", a, 0, LVAL_QEXPR);
 
-  lval *x = lval_take(a, 0);
+  lval *x = lval_mut(lval_take(a, 0));
   x->type = LVAL_SEXPR;
-  return lval_eval(e, x);
+  return x;
+}
+
+lval *builtin_eval(lenv *e, lval *a) {
+  return lval_eval(e, builtin_eval_expr(e, a));
 }
 
 lval *builtin_join(lenv *e, lval *a) {
@@ -67,12 +72,40 @@ lval *builtin_cons(lenv *e, lval *a) {
 
   lval *x = lval_pop(a, 0);
   lval *v = lval_pop(a, 0);
-  lval_add_front(v, x);
+  v = lval_add_front(v, x);
   lval_del(a);
   return v;
 }
 
+/*
+ * A call to a list builtin with fewer arguments than the prelude function it
+ * replaces took: the partial application that function gave, of a lambda with
+ * the space separated `formals` whose body calls `func`.
+ */
+static lval *builtin_curry(lenv *e, lval *a, lbuiltin func, char *formals) {
+  lval *f = lval_qexpr();
+  lval *body = lval_add(lval_qexpr(), lval_fun(func));
+  for (char *s = formals; *s;) {
+    size_t n = strcspn(s, " ");
+    f = lval_add(f, lval_sym_n(s, n));
+    body = lval_add(body, lval_sym_n(s, n));
+    s += n + (s[n] == ' ');
+  }
+  lval *g = lval_lambda(NULL, f, body);
+  int n = a->count;
+  for (int i = 0; i < n; i++) {
+    lstack_push(lval_copy(a->cell[i]));
+  }
+  lval *x = lval_apply(e, g, n);
+  lval_del(g);
+  lval_del(a);
+  return x;
+}
+
 lval *builtin_len(lenv *e, lval *a) {
+  if (a->count < 1) {
+    return builtin_curry(e, a, builtin_len, "l");
+  }
   LASSERT_NUM("len", a, 1);
   LASSERT_TYPE("len", a, 0, LVAL_QEXPR);
 
@@ -88,7 +121,381 @@ lval *builtin_init(lenv *e, lval *a) {
   LASSERT_NOT_EMPTY("init", a, 0);
 
   lval *x = lval_take(a, 0);
-  lval_del(lval_pop(x, x->count - 1));
+  return lval_slice(x, 0, x->count - 1);
+}
+
+/*
+ * An element as the prelude's `fst` returns it: evaluated as a one-element
+ * S-Expression. Only symbols, S-Expressions and functions are affected.
+ */
+static lval *builtin_item(lenv *e, lval *x) {
+  if (x->type != LVAL_SYM && x->type != LVAL_SEXPR && x->type != LVAL_FUN) {
+    return lval_copy(x);
+  }
+  return lval_eval(e, lval_add(lval_sexpr(), lval_copy(x)));
+}
+
+lval *builtin_nth(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_nth, "n l");
+  }
+  LASSERT_NUM("nth", a, 2);
+  LASSERT_TYPE("nth", a, 0, LVAL_NUM);
+  LASSERT_TYPE("nth", a, 1, LVAL_QEXPR);
+  LASSERT_NOT_EMPTY("nth", a, 1);
+
+  long n = a->cell[0]->num;
+  lval *l = a->cell[1];
+  LASSERT_RANGE("nth", a, 0, n, l->count - 1);
+  lval *x = builtin_item(e, l->cell[n]);
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_last(lenv *e, lval *a) {
+  if (a->count < 1) {
+    return builtin_curry(e, a, builtin_last, "l");
+  }
+  LASSERT_NUM("last", a, 1);
+  LASSERT_TYPE("last", a, 0, LVAL_QEXPR);
+  LASSERT_NOT_EMPTY("last", a, 0);
+
+  lval *l = a->cell[0];
+  lval *x = builtin_item(e, l->cell[l->count - 1]);
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_take(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_take, "n l");
+  }
+  LASSERT_NUM("take", a, 2);
+  LASSERT_TYPE("take", a, 0, LVAL_NUM);
+  LASSERT_TYPE("take", a, 1, LVAL_QEXPR);
+  LASSERT_RANGE("take", a, 0, a->cell[0]->num, a->cell[1]->count);
+
+  int n = a->cell[0]->num;
+  return lval_slice(lval_take(a, 1), 0, n);
+}
+
+lval *builtin_drop(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_drop, "n l");
+  }
+  LASSERT_NUM("drop", a, 2);
+  LASSERT_TYPE("drop", a, 0, LVAL_NUM);
+  LASSERT_TYPE("drop", a, 1, LVAL_QEXPR);
+  LASSERT_RANGE("drop", a, 0, a->cell[0]->num, a->cell[1]->count);
+
+  int n = a->cell[0]->num;
+  lval *l = lval_take(a, 1);
+  return lval_slice(l, n, l->count - n);
+}
+
+lval *builtin_split(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_split, "n l");
+  }
+  LASSERT_NUM("split", a, 2);
+  LASSERT_TYPE("split", a, 0, LVAL_NUM);
+  LASSERT_TYPE("split", a, 1, LVAL_QEXPR);
+  LASSERT_RANGE("split", a, 0, a->cell[0]->num, a->cell[1]->count);
+
+  int n = a->cell[0]->num;
+  lval *l = lval_take(a, 1);
+  lval *x = lval_add(lval_qexpr(), lval_slice(lval_copy(l), 0, n));
+  return lval_add(x, lval_slice(l, n, l->count - n));
+}
+
+lval *builtin_elem(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_elem, "x l");
+  }
+  LASSERT_NUM("elem", a, 2);
+  LASSERT_TYPE("elem", a, 1, LVAL_QEXPR);
+
+  lval *l = a->cell[1];
+  for (int i = 0; i < l->count; i++) {
+    lval *y = builtin_item(e, l->cell[i]);
+    int r = lval_eq(a->cell[0], y);
+    lval_del(y);
+    if (r) {
+      lval_del(a);
+      return lval_num(1);
+    }
+  }
+  lval_del(a);
+  return lval_num(0);
+}
+
+lval *builtin_map(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_map, "f l");
+  }
+  LASSERT_NUM("map", a, 2);
+  LASSERT_TYPE("map", a, 0, LVAL_FUN);
+  LASSERT_TYPE("map", a, 1, LVAL_QEXPR);
+
+  lval *f = a->cell[0];
+  lval *l = a->cell[1];
+  lval *x = lval_qexpr();
+  lval_reserve(x, l->count);
+  for (int i = 0; i < l->count; i++) {
+    lstack_push(builtin_item(e, l->cell[i]));
+    lval *y = lval_apply(e, f, 1);
+    if (y->type == LVAL_ERR) {
+      lval_del(x);
+      lval_del(a);
+      return y;
+    }
+    x = lval_add(x, y);
+  }
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_filter(lenv *e, lval *a) {
+  if (a->count < 2) {
+    return builtin_curry(e, a, builtin_filter, "f l");
+  }
+  LASSERT_NUM("filter", a, 2);
+  LASSERT_TYPE("filter", a, 0, LVAL_FUN);
+  LASSERT_TYPE("filter", a, 1, LVAL_QEXPR);
+
+  lval *f = a->cell[0];
+  lval *l = a->cell[1];
+  lval *x = lval_qexpr();
+  for (int i = 0; i < l->count; i++) {
+    lstack_push(builtin_item(e, l->cell[i]));
+    lval *y = lval_apply(e, f, 1);
+    if (y->type != LVAL_NUM) {
+      lval_del(x);
+      lval_del(a);
+      if (y->type == LVAL_ERR) {
+        return y;
+      }
+      lval *err = lval_err("Function 'filter' predicate returned incorrect "
+                           "type. Got %s, Expected %s.",
+                           ltype_name(y->type), ltype_name(LVAL_NUM));
+      lval_del(y);
+      return err;
+    }
+    if (y->num) {
+      x = lval_add(x, lval_copy(l->cell[i]));
+    }
+    lval_del(y);
+  }
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_foldl(lenv *e, lval *a) {
+  if (a->count < 3) {
+    return builtin_curry(e, a, builtin_foldl, "f z l");
+  }
+  LASSERT_NUM("foldl", a, 3);
+  LASSERT_TYPE("foldl", a, 0, LVAL_FUN);
+  LASSERT_TYPE("foldl", a, 2, LVAL_QEXPR);
+
+  lval *f = a->cell[0];
+  lval *l = a->cell[2];
+  lval *z = lval_copy(a->cell[1]);
+  for (int i = 0; i < l->count && z->type != LVAL_ERR; i++) {
+    lstack_push(z);
+    lstack_push(builtin_item(e, l->cell[i]));
+    z = lval_apply(e, f, 2);
+  }
+  lval_del(a);
+  return z;
+}
+
+/* `sum` and `product`: the items, evaluated as `fst` would, reduced by the
+ * `+` or `*` kernel with its overflow checks. */
+static lval *builtin_fold_op(lenv *e, lval *a, char *func, lbuiltin_fast op) {
+  LASSERT_NUM(func, a, 1);
+  LASSERT_TYPE(func, a, 0, LVAL_QEXPR);
+
+  lval *l = a->cell[0];
+  int at = lstack.sp;
+  for (int i = 0; i < l->count; i++) {
+    lval *y = builtin_item(e, l->cell[i]);
+    if (y->type == LVAL_ERR) {
+      lstack_drop(lstack.sp - at);
+      lval_del(a);
+      return y;
+    }
+    lstack_push(y);
+  }
+  lval *x = op(e, &lstack.vals[at], l->count);
+  lstack_drop(l->count);
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_sum(lenv *e, lval *a) {
+  if (a->count < 1) {
+    return builtin_curry(e, a, builtin_sum, "l");
+  }
+  return builtin_fold_op(e, a, "sum", builtin_add_fast);
+}
+
+lval *builtin_product(lenv *e, lval *a) {
+  if (a->count < 1) {
+    return builtin_curry(e, a, builtin_product, "l");
+  }
+  return builtin_fold_op(e, a, "product", builtin_mul_fast);
+}
+
+lval *builtin_vec(lenv *e, lval *a) {
+  lval *l = a;
+  if (a->count == 1 && a->cell[0]->type == LVAL_QEXPR) {
+    l = a->cell[0];
+  }
+  for (int i = 0; i < l->count; i++) {
+    LASSERT_TYPE("vec", l, i, LVAL_NUM);
+  }
+
+  lval *v = lval_vec(l->count);
+  for (int i = 0; i < l->count; i++) {
+    v->vec[i] = l->cell[i]->num;
+  }
+  lval_del(a);
+  return v;
+}
+
+lval *builtin_vec_list(lenv *e, lval *a) {
+  LASSERT_NUM("vec-list", a, 1);
+  LASSERT_TYPE("vec-list", a, 0, LVAL_VEC);
+
+  lval *v = a->cell[0];
+  lval *x = lval_qexpr();
+  lval_reserve(x, v->len);
+  for (int i = 0; i < v->len; i++) {
+    x = lval_add(x, lval_num(v->vec[i]));
+  }
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_vec_range(lenv *e, lval *a) {
+  LASSERT_NUM("vec-range", a, 1);
+  LASSERT_TYPE("vec-range", a, 0, LVAL_NUM);
+  LASSERT_RANGE("vec-range", a, 0, a->cell[0]->num, INT_MAX);
+
+  lval *v = lval_vec(a->cell[0]->num);
+  for (int i = 0; i < v->len; i++) {
+    v->vec[i] = i;
+  }
+  lval_del(a);
+  return v;
+}
+
+lval *builtin_vec_len(lenv *e, lval *a) {
+  LASSERT_NUM("vec-len", a, 1);
+  LASSERT_TYPE("vec-len", a, 0, LVAL_VEC);
+
+  lval *x = lval_num(a->cell[0]->len);
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_vec_slice(lenv *e, lval *a) {
+  LASSERT_NUM("vec-slice", a, 3);
+  LASSERT_TYPE("vec-slice", a, 0, LVAL_VEC);
+  LASSERT_TYPE("vec-slice", a, 1, LVAL_NUM);
+  LASSERT_TYPE("vec-slice", a, 2, LVAL_NUM);
+  LASSERT_RANGE("vec-slice", a, 1, a->cell[1]->num, a->cell[0]->len);
+  LASSERT_RANGE("vec-slice", a, 2, a->cell[2]->num,
+                a->cell[0]->len - a->cell[1]->num);
+
+  int i = a->cell[1]->num;
+  lval *v = lval_vec(a->cell[2]->num);
+  if (v->len) {
+    memcpy(v->vec, a->cell[0]->vec + i, sizeof(long) * v->len);
+  }
+  lval_del(a);
+  return v;
+}
+
+/* `vec+` and `vec*`, writing into the first vector when it is not shared. */
+static lval *builtin_vec_zip(lval *a, char *func,
+                             void (*kernel)(long *, const long *, const long *,
+                                            int)) {
+  LASSERT_NUM(func, a, 2);
+  LASSERT_TYPE(func, a, 0, LVAL_VEC);
+  LASSERT_TYPE(func, a, 1, LVAL_VEC);
+  LASSERT(a, a->cell[0]->len == a->cell[1]->len,
+          "Function '%s' passed vectors of different lengths. "
+          "Got %i and %i.",
+          func, a->cell[0]->len, a->cell[1]->len);
+
+  lval *v = lval_copy(a->cell[0]);
+  lval *y = lval_copy(a->cell[1]);
+  lval_del(a);
+  lval *x = v->ref == 1 ? lval_copy(v) : lval_vec(v->len);
+  kernel(x->vec, v->vec, y->vec, v->len);
+  lval_del(v);
+  lval_del(y);
+  return x;
+}
+
+lval *builtin_vec_add(lenv *e, lval *a) {
+  return builtin_vec_zip(a, "vec+", lvec_add);
+}
+
+lval *builtin_vec_mul(lenv *e, lval *a) {
+  return builtin_vec_zip(a, "vec*", lvec_mul);
+}
+
+lval *builtin_vec_dot(lenv *e, lval *a) {
+  LASSERT_NUM("vec-dot", a, 2);
+  LASSERT_TYPE("vec-dot", a, 0, LVAL_VEC);
+  LASSERT_TYPE("vec-dot", a, 1, LVAL_VEC);
+  LASSERT(a, a->cell[0]->len == a->cell[1]->len,
+          "Function 'vec-dot' passed vectors of different lengths. "
+          "Got %i and %i.",
+          a->cell[0]->len, a->cell[1]->len);
+
+  lval *v = a->cell[0];
+  lval *x = lval_num(lvec_dot(v->vec, a->cell[1]->vec, v->len));
+  lval_del(a);
+  return x;
+}
+
+/* `vec-sum`, `vec-min` and `vec-max`; min and max need an element. */
+static lval *builtin_vec_reduce(lval *a, char *func,
+                                long (*kernel)(const long *, int), int empty) {
+  LASSERT_NUM(func, a, 1);
+  LASSERT_TYPE(func, a, 0, LVAL_VEC);
+  LASSERT(a, empty || a->cell[0]->len,
+          "Function '%s' passed [] for argument 0.", func);
+
+  lval *x = lval_num(kernel(a->cell[0]->vec, a->cell[0]->len));
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_vec_sum(lenv *e, lval *a) {
+  return builtin_vec_reduce(a, "vec-sum", lvec_sum, 1);
+}
+
+lval *builtin_vec_min(lenv *e, lval *a) {
+  return builtin_vec_reduce(a, "vec-min", lvec_min, 0);
+}
+
+lval *builtin_vec_max(lenv *e, lval *a) {
+  return builtin_vec_reduce(a, "vec-max", lvec_max, 0);
+}
+
+lval *builtin_vec_scan(lenv *e, lval *a) {
+  LASSERT_NUM("vec-scan", a, 1);
+  LASSERT_TYPE("vec-scan", a, 0, LVAL_VEC);
+
+  lval *v = lval_take(a, 0);
+  lval *x = v->ref == 1 ? lval_copy(v) : lval_vec(v->len);
+  lvec_scan(x->vec, v->vec, v->len);
+  lval_del(v);
   return x;
 }
 
@@ -109,6 +516,9 @@ lval *builtin_var(lenv *e, lval *a, char *func) {
           func, syms->count, a->count - 1);
 
   for (int i = 0; i < syms->count; i++) {
+    if (a->cell[i + 1]->type == LVAL_FUN) {
+      lprof_name(a->cell[i + 1], syms->cell[i]->sym);
+    }
     if (strcmp(func, "def") == 0) {
       lenv_def(e, syms->cell[i], a->cell[i + 1]);
     }
@@ -141,7 +551,7 @@ lval *builtin_lambda(lenv *e, lval *a) {
   lval *body = lval_pop(a, 0);
   lval_del(a);
 
-  return lval_lambda(formals, body);
+  return lval_lambda(e, formals, body);
 }
 
 lval *builtin_fun(lenv *e, lval *a) {
@@ -153,7 +563,7 @@ lval *builtin_fun(lenv *e, lval *a) {
     LASSERT_TYPE("\\", a->cell[0], i, LVAL_SYM);
   }
 
-  lval *formals = lval_pop(a, 0);
+  lval *formals = lval_mut(lval_pop(a, 0));
   LASSERT(formals, formals->count > 1,
           "Function '%s' passed incorrect number of symbols. "
           "Got %i, Expected %s.",
@@ -161,7 +571,7 @@ lval *builtin_fun(lenv *e, lval *a) {
 
   lval *func_name = lval_add(lval_qexpr(), lval_pop(formals, 0));
   lval *body = lval_pop(a, 0);
-  lval *lambda = lval_lambda(formals, body);
+  lval *lambda = lval_lambda(e, formals, body);
   lval *args = lval_add(lval_add(lval_sexpr(), func_name), lambda);
   lval_del(a);
 
@@ -169,6 +579,7 @@ lval *builtin_fun(lenv *e, lval *a) {
 }
 
 lval *builtin_exit(lenv *e, lval *a) {
+  lprof_report();
   if (a->count == 0) {
     exit(0);
   }
@@ -180,170 +591,307 @@ lval *builtin_exit(lenv *e, lval *a) {
   return lval_err("exit");
 }
 
-lval *builtin_op(lenv *e, lval *a, char *op) {
-  for (int i = 0; i < a->count; i++) {
-    if (a->cell[i]->type != LVAL_NUM) {
-      lval_del(a);
+/*
+ * Arithmetic kernels. Each builtin type-checks its arguments in one pass and
+ * then reduces the cell array directly, detecting overflow instead of
+ * wrapping. Sums are accumulated in 128 bits over four independent lanes, so
+ * only a total that does not fit in a long is an overflow. The kernels are
+ * the fast paths; the list-taking builtins run them on the list's cells.
+ */
+static lval *builtin_cells(lenv *e, lval *a, lbuiltin_fast fast) {
+  lval *x = fast(e, a->cell, a->count);
+  lval_del(a);
+  return x;
+}
+
+static lval *builtin_nums(lval **a, int n) {
+  for (int i = 0; i < n; i++) {
+    if (a[i]->type != LVAL_NUM) {
       return lval_err("Cannot operate on non-number!");
     }
   }
+  return NULL;
+}
 
-  lval *x = lval_pop(a, 0);
-  if ((strcmp(op, "-") == 0) && a->count == 0) {
-    x->num = -x->num;
+static __int128 builtin_sum_cells(lval **c, int n) {
+  __int128 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += c[i]->num;
+    s1 += c[i + 1]->num;
+    s2 += c[i + 2]->num;
+    s3 += c[i + 3]->num;
+  }
+  for (; i < n; i++) {
+    s0 += c[i]->num;
   }
+  return (s0 + s1) + (s2 + s3);
+}
 
-  while (a->count > 0) {
-    lval *y = lval_pop(a, 0);
-    if (strcmp(op, "+") == 0) {
-      x->num += y->num;
-    }
-    if (strcmp(op, "-") == 0) {
-      x->num -= y->num;
-    }
-    if (strcmp(op, "*") == 0) {
-      x->num *= y->num;
-    }
-    if (strcmp(op, "/") == 0) {
-      if (y->num == 0) {
-        lval_del(x);
-        lval_del(y);
-        x = lval_err("Division By Zero!");
-        break;
-      }
-      x->num /= y->num;
-    }
-    lval_del(y);
+static lval *builtin_wide(__int128 x) {
+  if (x < LONG_MIN || x > LONG_MAX) {
+    return lval_err("Integer Overflow!");
   }
-  lval_del(a);
-  return x;
+  return lval_num(x);
 }
 
-lval *builtin_add(lenv *e, lval *a) { return builtin_op(e, a, "+"); }
-lval *builtin_sub(lenv *e, lval *a) { return builtin_op(e, a, "-"); }
-lval *builtin_mul(lenv *e, lval *a) { return builtin_op(e, a, "*"); }
-lval *builtin_div(lenv *e, lval *a) { return builtin_op(e, a, "/"); }
+lval *builtin_add_fast(lenv *e, lval **a, int n) {
+  lval *err = builtin_nums(a, n);
+  if (err) {
+    return err;
+  }
+  return builtin_wide(builtin_sum_cells(a, n));
+}
 
-lval *builtin_ord(lenv *e, lval *a, char *op) {
-  LASSERT_NUM(op, a, 2);
-  LASSERT_TYPE(op, a, 0, LVAL_NUM);
-  LASSERT_TYPE(op, a, 1, LVAL_NUM);
+lval *builtin_sub_fast(lenv *e, lval **a, int n) {
+  lval *err = builtin_nums(a, n);
+  if (err) {
+    return err;
+  }
+  LCHECK(n > 0, "Function '%s' passed no arguments.", "-");
+  __int128 x = a[0]->num;
+  if (n == 1) {
+    return builtin_wide(-x);
+  }
+  return builtin_wide(x - builtin_sum_cells(a + 1, n - 1));
+}
 
-  int r;
-  if (strcmp(op, ">") == 0) {
-    r = (a->cell[0]->num > a->cell[1]->num);
+lval *builtin_mul_fast(lenv *e, lval **a, int n) {
+  lval *err = builtin_nums(a, n);
+  if (err) {
+    return err;
   }
-  if (strcmp(op, "<") == 0) {
-    r = (a->cell[0]->num < a->cell[1]->num);
+  long x = 1;
+  for (int i = 0; i < n; i++) {
+    LCHECK(!__builtin_mul_overflow(x, a[i]->num, &x), "Integer Overflow!");
   }
-  if (strcmp(op, ">=") == 0) {
-    r = (a->cell[0]->num >= a->cell[1]->num);
+  return lval_num(x);
+}
+
+lval *builtin_div_fast(lenv *e, lval **a, int n) {
+  lval *err = builtin_nums(a, n);
+  if (err) {
+    return err;
   }
-  if (strcmp(op, "<=") == 0) {
-    r = (a->cell[0]->num <= a->cell[1]->num);
+  LCHECK(n > 0, "Function '%s' passed no arguments.", "/");
+  long x = a[0]->num;
+  for (int i = 1; i < n; i++) {
+    long y = a[i]->num;
+    LCHECK(y != 0, "Division By Zero!");
+    LCHECK(!(x == LONG_MIN && y == -1), "Integer Overflow!");
+    x /= y;
   }
-  lval_del(a);
-  return lval_num(r);
+  return lval_num(x);
 }
 
-lval *builtin_gt(lenv *e, lval *a) { return builtin_ord(e, a, ">"); }
-lval *builtin_lt(lenv *e, lval *a) { return builtin_ord(e, a, "<"); }
-lval *builtin_ge(lenv *e, lval *a) { return builtin_ord(e, a, ">="); }
-lval *builtin_le(lenv *e, lval *a) { return builtin_ord(e, a, "<="); }
+lval *builtin_add(lenv *e, lval *a) {
+  return builtin_cells(e, a, builtin_add_fast);
+}
+
+lval *builtin_sub(lenv *e, lval *a) {
+  return builtin_cells(e, a, builtin_sub_fast);
+}
+
+lval *builtin_mul(lenv *e, lval *a) {
+  return builtin_cells(e, a, builtin_mul_fast);
+}
+
+lval *builtin_div(lenv *e, lval *a) {
+  return builtin_cells(e, a, builtin_div_fast);
+}
+
+/* Comparison kernels, one per operator. */
+#define BUILTIN_ORD(name, op)                                                  \
+  lval *name##_fast(lenv *e, lval **a, int n) {                                \
+    LCHECK_NUM(#op, n, 2);                                                     \
+    LCHECK_TYPE(#op, a, 0, LVAL_NUM);                                          \
+    LCHECK_TYPE(#op, a, 1, LVAL_NUM);                                          \
+    return lval_num(a[0]->num op a[1]->num);                                   \
+  }                                                                            \
+  lval *name(lenv *e, lval *a) { return builtin_cells(e, a, name##_fast); }
+
+BUILTIN_ORD(builtin_gt, >)
+BUILTIN_ORD(builtin_lt, <)
+BUILTIN_ORD(builtin_ge, >=)
+BUILTIN_ORD(builtin_le, <=)
+
+lval *builtin_eq_fast(lenv *e, lval **a, int n) {
+  LCHECK_NUM("==", n, 2);
+  return lval_num(lval_eq(a[0], a[1]));
+}
+
+lval *builtin_ne_fast(lenv *e, lval **a, int n) {
+  LCHECK_NUM("!=", n, 2);
+  return lval_num(!lval_eq(a[0], a[1]));
+}
 
 lval *builtin_cmp(lenv *e, lval *a, char *op) {
-  LASSERT_NUM(op, a, 2);
-  int r;
   if (strcmp(op, "==") == 0) {
-    r = lval_eq(a->cell[0], a->cell[1]);
-  }
-  if (strcmp(op, "!=") == 0) {
-    r = !lval_eq(a->cell[0], a->cell[1]);
+    return builtin_cells(e, a, builtin_eq_fast);
   }
-  lval_del(a);
-  return lval_num(r);
+  return builtin_cells(e, a, builtin_ne_fast);
 }
 lval *builtin_eq(lenv *e, lval *a) { return builtin_cmp(e, a, "=="); }
 lval *builtin_ne(lenv *e, lval *a) { return builtin_cmp(e, a, "!="); }
 
 lval *builtin_logic(lenv *e, lval *a, char *op) {
-  LASSERT_NUM(op, a, 2);
-  LASSERT_TYPE(op, a, 0, LVAL_NUM);
-  LASSERT_TYPE(op, a, 1, LVAL_NUM);
-  int r;
-  if (strcmp(op, "&&") == 0) {
-    r = (a->cell[0]->num && a->cell[1]->num);
-  }
-  if (strcmp(op, "||") == 0) {
-    r = (a->cell[0]->num || a->cell[1]->num);
+  /* Stop at the first operand that decides, as the special form does. */
+  int any = strcmp(op, "||") == 0;
+  for (int i = 0; i < a->count; i++) {
+    LASSERT_TYPE(op, a, i, LVAL_NUM);
+    if ((a->cell[i]->num != 0) == any) {
+      lval_del(a);
+      return lval_num(any);
+    }
   }
   lval_del(a);
-  return lval_num(r);
+  return lval_num(!any);
 }
 lval *builtin_and(lenv *e, lval *a) { return builtin_logic(e, a, "&&"); }
 lval *builtin_or(lenv *e, lval *a) { return builtin_logic(e, a, "||"); }
+lval *builtin_not_fast(lenv *e, lval **a, int n) {
+  LCHECK_NUM("not", n, 1);
+  LCHECK_TYPE("not", a, 0, LVAL_NUM);
+  return lval_num(!a[0]->num);
+}
 lval *builtin_not(lenv *e, lval *a) {
-  LASSERT_NUM("not", a, 1);
-  LASSERT_TYPE("not", a, 0, LVAL_NUM);
-  lval *x = lval_num(!a->cell[0]->num);
-  lval_del(a);
-  return x;
+  return builtin_cells(e, a, builtin_not_fast);
 }
 
-lval *builtin_if(lenv *e, lval *a) {
+lval *builtin_if_branch(lenv *e, lval *a) {
   LASSERT_NUM("if", a, 3);
   LASSERT_TYPE("if", a, 0, LVAL_NUM);
   LASSERT_TYPE("if", a, 1, LVAL_QEXPR);
   LASSERT_TYPE("if", a, 2, LVAL_QEXPR);
 
-  lval *x;
-  a->cell[1]->type = LVAL_SEXPR;
-  a->cell[2]->type = LVAL_SEXPR;
+  lval *x = lval_mut(lval_take(a, a->cell[0]->num ? 1 : 2));
+  x->type = LVAL_SEXPR;
+  return x;
+}
 
-  if (a->cell[0]->num) {
-    x = lval_eval(e, lval_pop(a, 1));
-  } else {
-    x = lval_eval(e, lval_pop(a, 2));
+lval *builtin_if(lenv *e, lval *a) {
+  return lval_eval(e, builtin_if_branch(e, a));
+}
+
+lval *builtin_cond(lval *x, char *func, int i) {
+  if (x->type == LVAL_ERR) {
+    return lval_copy(x);
   }
+  if (x->type != LVAL_NUM) {
+    return lval_err("Function '%s' passed incorrect type for argument %i. "
+                    "Got %s, Expected %s.",
+                    func, i, ltype_name(x->type), ltype_name(LVAL_NUM));
+  }
+  return NULL;
+}
 
-  lval_del(a);
-  return x;
+/* Element `i` of a case as an expression, evaluated as `(eval {x})` is. */
+static lval *builtin_case_part(lval *c, int i) {
+  return lval_add(lval_sexpr(), lval_copy(c->cell[i]));
 }
 
-lval *builtin_load(lenv *e, lval *a) {
-  LASSERT_NUM("load", a, 1);
-  LASSERT_TYPE("load", a, 0, LVAL_STR);
+/* The value of a case as an expression. An S-Expression is evaluated as it
+ * stands, so a call there is a tail call of `select` or `case`. */
+static lval *builtin_case_value(lval *c) {
+  if (c->cell[1]->type == LVAL_SEXPR) {
+    return lval_copy(c->cell[1]);
+  }
+  return builtin_case_part(c, 1);
+}
 
-  mpc_result_t r;
-  if (mpc_parse_contents(a->cell[0]->str, Lispy, &r)) {
+#define LASSERT_CASES(func, args, from)                                        \
+  for (int i = from; i < args->count; i++) {                                   \
+    LASSERT_TYPE(func, args, i, LVAL_QEXPR);                                   \
+    LASSERT(args, args->cell[i]->count >= 2,                                   \
+            "Function '%s' passed incorrect case for argument %i. "            \
+            "Got %i values, Expected 2.",                                      \
+            func, i, args->cell[i]->count);                                    \
+  }
 
-    lval *expr = lval_read(r.output);
-    mpc_ast_delete(r.output);
+lval *builtin_select_branch(lenv *e, lval *a) {
+  LASSERT_CASES("select", a, 0);
 
-    while (expr->count) {
-      lval *x = lval_eval(e, lval_pop(expr, 0));
-      /* If Evaluation leads to error print it */
-      if (x->type == LVAL_ERR) {
-        lval_println(x);
-      }
+  for (int i = 0; i < a->count; i++) {
+    lval *x = lval_eval(e, builtin_case_part(a->cell[i], 0));
+    lval *err = builtin_cond(x, "select", i);
+    if (err || x->num) {
+      lval *y = err ? err : builtin_case_value(a->cell[i]);
       lval_del(x);
+      lval_del(a);
+      return y;
     }
+    lval_del(x);
+  }
+  lval_del(a);
+  return lval_err("No Selection Found");
+}
 
-    lval_del(expr);
-    lval_del(a);
+lval *builtin_select(lenv *e, lval *a) {
+  return lval_eval(e, builtin_select_branch(e, a));
+}
 
-    return lval_sexpr();
+lval *builtin_case_branch(lenv *e, lval *a) {
+  LASSERT(a, a->count >= 1,
+          "Function 'case' passed incorrect number of arguments. "
+          "Got %i, Expected at least %i.",
+          a->count, 1);
+  LASSERT_CASES("case", a, 1);
 
-  } else {
-    char *err_msg = mpc_err_string(r.error);
-    mpc_err_delete(r.error);
+  for (int i = 1; i < a->count; i++) {
+    lval *k = lval_eval(e, builtin_case_part(a->cell[i], 0));
+    if (k->type == LVAL_ERR) {
+      lval_del(a);
+      return k;
+    }
+    int eq = lval_eq(a->cell[0], k);
+    lval_del(k);
+    if (eq) {
+      lval *y = builtin_case_value(a->cell[i]);
+      lval_del(a);
+      return y;
+    }
+  }
+  lval_del(a);
+  return lval_err("No Case Found");
+}
+
+lval *builtin_case(lenv *e, lval *a) {
+  return lval_eval(e, builtin_case_branch(e, a));
+}
 
-    lval *err = lval_err("Could not load Library %s", err_msg);
-    free(err_msg);
+lval *builtin_do(lenv *e, lval *a) {
+  if (a->count == 0) {
     lval_del(a);
+    return lval_qexpr();
+  }
+  return lval_take(a, a->count - 1);
+}
 
-    return err;
+lval *builtin_let(lenv *e, lval *a) {
+  LASSERT_NUM("let", a, 1);
+  LASSERT_TYPE("let", a, 0, LVAL_QEXPR);
+
+  lenv *s = lenv_frame();
+  s->par = e;
+  lval *x = lval_mut(lval_take(a, 0));
+  x->type = LVAL_SEXPR;
+  x = lval_eval(s, x);
+  lenv_del(s);
+  return x;
+}
+
+lval *builtin_load(lenv *e, lval *a) {
+  LASSERT_NUM("load", a, 1);
+  LASSERT_TYPE("load", a, 0, LVAL_STR);
+
+  lval *x = parse_load(e, a->cell[0]->str);
+  if (x->type == LVAL_ERR) {
+    lval *err = lval_err("Could not load Library %s", x->err);
+    lval_del(x);
+    x = err;
   }
+  lval_del(a);
+  return x;
 }
 
 lval *builtin_print(lenv *e, lval *a) {
@@ -367,3 +915,62 @@ lval *builtin_error(lenv *e, lval *a) {
   lval_del(a);
   return err;
 }
+
+lval *builtin_mem_stats(lenv *e, lval *a) {
+  LASSERT_NUM("mem-stats", a, 0);
+
+  lval_del(a);
+  return lstats_list();
+}
+
+lval *builtin_memo(lenv *e, lval *a) {
+  LASSERT(a, a->count == 1 || a->count == 2,
+          "Function 'memo' passed incorrect number of arguments. "
+          "Got %i, Expected 1 or 2.",
+          a->count);
+  LASSERT_TYPE("memo", a, 0, LVAL_FUN);
+  LASSERT(a, !a->cell[0]->builtin,
+          "Function 'memo' cannot memoize a builtin function.");
+  int cap = LMEMO_CAP;
+  if (a->count == 2) {
+    LASSERT_TYPE("memo", a, 1, LVAL_NUM);
+    LASSERT(a, a->cell[1]->num > 0 && a->cell[1]->num <= INT_MAX,
+            "Function 'memo' passed out of range value for argument 1. "
+            "Got %li, Expected 1 to %i.",
+            a->cell[1]->num, INT_MAX);
+    cap = a->cell[1]->num;
+  }
+
+  /* Fresh code carries a cache of its own, leaving the argument uncached. */
+  lval *f = lval_mut(lval_take(a, 0));
+  lcode *c = lcode_compile(e, f->formals, f->body);
+  c->name = f->code->name;
+  c->memo = lmemo_new(cap);
+  lcode_del(f->code);
+  f->code = c;
+  return f;
+}
+
+lval *builtin_memo_stats(lenv *e, lval *a) {
+  LASSERT_NUM("memo-stats", a, 1);
+  LASSERT_TYPE("memo-stats", a, 0, LVAL_FUN);
+  lval *f = a->cell[0];
+  LASSERT(a, !f->builtin && f->code->memo,
+          "Function 'memo-stats' passed a function that is not memoized.");
+
+  lval *x = lmemo_list(f->code->memo);
+  lval_del(a);
+  return x;
+}
+
+lval *builtin_profile(lenv *e, lval *a) {
+  LASSERT_NUM("profile", a, 1);
+  LASSERT_TYPE("profile", a, 0, LVAL_QEXPR);
+
+  int own = lprof_start(0);
+  lval *x = lval_eval(e, builtin_eval_expr(e, a));
+  if (own) {
+    lprof_report();
+  }
+  return x;
+}
@@ -23,6 +23,8 @@ char *ltype_name(int t) {
     return "S-Expression";
   case LVAL_QEXPR:
     return "Q-Expression";
+  case LVAL_VEC:
+    return "Vector";
   default:
     return "Unknown";
   }
@@ -47,6 +49,14 @@ void lval_expr_print(lval *v, char open, char close) {
   putchar(close);
 }
 
+void lval_vec_print(lval *v) {
+  putchar('[');
+  for (int i = 0; i < v->len; i++) {
+    printf(i ? " %li" : "%li", v->vec[i]);
+  }
+  putchar(']');
+}
+
 void lval_print(lval *v) {
   switch (v->type) {
   case LVAL_NUM:
@@ -67,6 +77,9 @@ void lval_print(lval *v) {
   case LVAL_QEXPR:
     lval_expr_print(v, '{', '}');
     break;
+  case LVAL_VEC:
+    lval_vec_print(v);
+    break;
   case LVAL_FUN:
     if (v->builtin) {
       printf("<builtin>");
@@ -2,7 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "local-include/lcode.h"
 #include "local-include/lenv.h"
+#include "local-include/lmem.h"
+#include "local-include/lmemo.h"
+#include "local-include/lprof.h"
+#include "local-include/lstack.h"
+#include "local-include/lsym.h"
 #include "local-include/lval.h"
 #include <clisp.h>
 #include <mpc.h>
@@ -10,117 +16,395 @@
 lval *lval_pop(lval *v, int i) {
   lval *x = v->cell[i];
 
-  memmove(&v->cell[i], &v->cell[i + 1], sizeof(lval *) * (v->count - i - 1));
+  /* Popping the head only moves the start of the array forward. */
+  if (i == 0) {
+    v->cell++;
+    v->off++;
+  } else {
+    memmove(&v->cell[i], &v->cell[i + 1],
+            sizeof(lval *) * (v->count - i - 1));
+  }
 
   v->count--;
-  v->cell = realloc(v->cell, sizeof(lval *) * v->count);
+  v->hash = 0;
   return x;
 }
 
 lval *lval_take(lval *v, int i) {
+  if (v->ref > 1 || v->base) {
+    lval *x = lval_copy(v->cell[i]);
+    lval_del(v);
+    return x;
+  }
   lval *x = lval_pop(v, i);
   lval_del(v);
   return x;
 }
 
-lval *lval_call(lenv *e, lval *f, lval *a) {
-  if (f->builtin) {
-    return f->builtin(e, a);
+/*
+ * Bind the `n` arguments `args` to the formals of `f` in a fresh frame, after
+ * the arguments bound by earlier partial applications of `f`. The arguments
+ * are shared, not taken. Returns NULL with the frame in `*frame` once every
+ * formal is bound. Otherwise returns an error, or a partial application whose
+ * formals are the remaining ones and whose environment is the frame.
+ */
+static lval *lval_bind(lval *f, lval **args, int n, lenv **frame) {
+  static char *amp = NULL;
+  if (!amp) {
+    amp = lsym_intern("&");
   }
 
-  int given = a->count;
-  int total = f->formals->count;
-  while (a->count) {
-    if (f->formals->count == 0) {
-      lval_del(a);
+  lval *formals = f->formals;
+  lenv *env = lenv_frame();
+  lenv_reserve(env, (f->env ? f->env->count : 0) + formals->count);
+  if (f->env) {
+    lenv_merge(env, f->env);
+  }
+
+  int total = formals->count;
+  int i = 0;
+  for (int j = 0; j < n; j++) {
+    if (i == total) {
+      lenv_del(env);
       return lval_err("Function passed too many arguments. "
                       "Got %i, Expected %i.",
-                      given, total);
+                      n, total);
     }
-    lval *sym = lval_pop(f->formals, 0);
-    if (strcmp(sym->sym, "&") == 0) {
-      if (f->formals->count != 1) {
-        lval_del(a);
+    lval *sym = formals->cell[i++];
+    if (sym->sym == amp) {
+      if (total - i != 1) {
+        lenv_del(env);
         return lval_err("Function format invalid. "
                         "Symbol '&' not followed by single symbol.");
       }
-      lval *nsym = lval_pop(f->formals, 0);
-      lenv_put(f->env, nsym, builtin_list(e, a));
-      lval_del(sym);
-      lval_del(nsym);
+      lval *rest = lval_qexpr();
+      lval_reserve(rest, n - j);
+      for (; j < n; j++) {
+        rest = lval_add(rest, lval_copy(args[j]));
+      }
+      lenv_put(env, formals->cell[i++], rest);
+      lval_del(rest);
       break;
     }
-    lval *val = lval_pop(a, 0);
-    lenv_put(f->env, sym, val);
-    lval_del(sym);
-    lval_del(val);
+    lenv_put(env, sym, args[j]);
   }
-  lval_del(a);
-  if (f->formals->count > 0 && strcmp(f->formals->cell[0]->sym, "&") == 0) {
-    if (f->formals->count != 2) {
+  if (i < total && formals->cell[i]->sym == amp) {
+    if (total - i != 2) {
+      lenv_del(env);
       return lval_err("Function format invalid. "
                       "Symbol '&' not followed by single symbol.");
     }
-    lval_del(lval_pop(f->formals, 0));
-    lval *sym = lval_pop(f->formals, 0);
     lval *val = lval_qexpr();
-    lenv_put(f->env, sym, val);
-    lval_del(sym);
+    lenv_put(env, formals->cell[i + 1], val);
     lval_del(val);
+    i += 2;
   }
-  if (f->formals->count == 0) {
-    f->env->par = e;
-    return builtin_eval(f->env, lval_add(lval_sexpr(), lval_copy(f->body)));
-  } else {
-    return lval_copy(f);
+
+  if (i == total) {
+    *frame = env;
+    return NULL;
   }
-}
 
-lval *lval_eval_sexpr(lenv *e, lval *v) {
-  for (int i = 0; i < v->count; i++) {
-    v->cell[i] = lval_eval(e, v->cell[i]);
+  /* The bindings so far become the environment the partial application
+   * shares between its copies. */
+  lval *p = lval_mut(lval_copy(f));
+  if (p->env) {
+    lenv_del(p->env);
   }
-  for (int i = 0; i < v->count; i++) {
-    if (v->cell[i]->type == LVAL_ERR) {
-      return lval_take(v, i);
+  p->env = env;
+  if (i > 0) {
+    p->formals = lval_qexpr();
+    for (; i < total; i++) {
+      p->formals = lval_add(p->formals, lval_copy(formals->cell[i]));
     }
+    lval_del(formals);
   }
-  if (v->count == 0) {
-    return v;
+  return p;
+}
+
+static lval *lval_run(lenv *e, lval *f, int n, lval *v);
+
+/* The builtins whose result is an expression to evaluate in tail position,
+ * and what picks that expression. */
+static lbuiltin lval_tail_of(lbuiltin f) {
+  if (f == builtin_if) {
+    return builtin_if_branch;
   }
-  if (v->count == 1) {
-    lval *f = lval_pop(v, 0);
-    if (f->type == LVAL_FUN) {
-      lval *result = lval_call(e, f, v);
-      lval_del(f);
-      return result;
-    } else {
+  if (f == builtin_eval) {
+    return builtin_eval_expr;
+  }
+  if (f == builtin_select) {
+    return builtin_select_branch;
+  }
+  if (f == builtin_case) {
+    return builtin_case_branch;
+  }
+  return NULL;
+}
+
+/*
+ * `(and ...)` and `(or ...)` with the operator `op` bound to the builtin: the
+ * operands of `v` are evaluated in order until the result is known.
+ */
+static lval *lval_logic(lenv *e, lval *op, lval *v) {
+  int any = op->builtin == builtin_or;
+  lval_del(op);
+  for (int i = 1; i < v->count; i++) {
+    lval *x = lval_eval(e, lval_copy(v->cell[i]));
+    lval *err = builtin_cond(x, any ? "||" : "&&", i - 1);
+    int t = !err && x->num != 0;
+    lval_del(x);
+    if (err || t == any) {
       lval_del(v);
-      return f;
+      return err ? err : lval_num(any);
     }
   }
-  lval *f = lval_pop(v, 0);
-  if (f->type != LVAL_FUN) {
-    lval *err = lval_err("S-Expression starts with incorrect type. "
-                         "Got %s, Expected %s.",
-                         ltype_name(f->type), ltype_name(LVAL_FUN));
-    lval_del(f);
-    lval_del(v);
-    return err;
+  lval_del(v);
+  return lval_num(!any);
+}
+
+lval *lval_form(int n, lval **f) {
+  lval **s = &lstack.vals[lstack.sp - n];
+  *f = NULL;
+  for (int i = 0; i < n; i++) {
+    if (s[i]->type == LVAL_ERR) {
+      lval *x = s[i];
+      for (int j = 0; j < n; j++) {
+        if (j != i) {
+          lval_del(s[j]);
+        }
+      }
+      lstack.sp -= n;
+      return x;
+    }
   }
-  lval *result = lval_call(e, f, v);
-  lval_del(f);
-  return result;
+  if (n == 0) {
+    return lval_sexpr();
+  }
+
+  if (s[0]->type != LVAL_FUN) {
+    if (n == 1) {
+      lstack.sp--;
+      return s[0];
+    }
+    lval *x = lval_err("S-Expression starts with incorrect type. "
+                       "Got %s, Expected %s.",
+                       ltype_name(s[0]->type), ltype_name(LVAL_FUN));
+    lstack_drop(n);
+    return x;
+  }
+
+  *f = s[0];
+  memmove(s, s + 1, sizeof(lval *) * (n - 1));
+  lstack.sp--;
+  return NULL;
 }
 
-lval *lval_eval(lenv *e, lval *v) {
-  if (v->type == LVAL_SYM) {
-    lval *x = lenv_get(e, v);
-    lval_del(v);
+/*
+ * Evaluate the cells of the S-Expression `v` onto the stack, then sort out
+ * what they form as `lval_form` does, leaving `*n` arguments for a call.
+ */
+static lval *lval_cells(lenv *e, lval *v, lval **f, int *n) {
+  int count = v->count;
+  int i = 0;
+  lstack_reserve(count);
+  /* `and` and `or` are looked at before their operands are evaluated. */
+  if (count && v->cell[0]->type == LVAL_SYM) {
+    lval *x = lenv_get(e, v->cell[0]);
+    if (x->type == LVAL_FUN &&
+        (x->builtin == builtin_and || x->builtin == builtin_or)) {
+      *f = NULL;
+      return lval_logic(e, x, v);
+    }
+    lstack.vals[lstack.sp++] = x;
+    i = 1;
+  }
+  for (; i < count; i++) {
+    lval *x = v->cell[i];
+    /* Everything but symbols and S-Expressions evaluates to itself. */
+    if (x->type == LVAL_SYM) {
+      x = lenv_get(e, x);
+    } else if (x->type == LVAL_SEXPR) {
+      x = lval_eval(e, lval_copy(x));
+    } else {
+      x = lval_copy(x);
+    }
+    lstack.vals[lstack.sp++] = x;
+  }
+  lval_del(v);
+  *n = count - 1;
+  return lval_form(count, f);
+}
+
+/*
+ * Call the memoized lambda `f` on the arguments `a`. A miss runs the body in
+ * a nested evaluator so the result can be stored, which means calls to a
+ * memoized function are never tail calls. Errors are not stored.
+ */
+static lval *lval_memo(lenv *e, lval *f, lval *a) {
+  lval *x = lmemo_get(f->code->memo, a);
+  if (x) {
+    lval_del(a);
     return x;
   }
-  if (v->type == LVAL_SEXPR) {
-    return lval_eval_sexpr(e, v);
+
+  lenv *env;
+  lval *g = lval_bind(f, a->cell, a->count, &env);
+  if (g) {
+    lval_del(a);
+    /* The rest of the arguments of a partial application come later, out of
+     * reach of the key, so it runs uncached on code of its own. */
+    if (g->type != LVAL_ERR) {
+      lcode *c = lcode_compile(e, f->formals, g->body);
+      c->name = g->code->name;
+      lcode_del(g->code);
+      g->code = c;
+    }
+    return g;
+  }
+  env->par = e;
+  int prof = lprof_on;
+  if (prof) {
+    lprof_enter(f);
+  }
+  int at = lstack.sp;
+  lval *h;
+  x = lcode_run(env, f->code, &h);
+  if (h) {
+    x = lval_run(env, h, lstack.sp - at, NULL);
+  }
+  if (prof) {
+    lprof_leave();
+  }
+  if (x->type != LVAL_ERR) {
+    lmemo_put(f->code->memo, a, x);
+  }
+  lval_del(a);
+  lenv_del(env);
+  return x;
+}
+
+/*
+ * The evaluator proper. Applies `f` to the `n` values on top of the stack,
+ * or evaluates `v` when `f` is NULL. Calls in tail position (the branches of
+ * `if`, the argument of `eval` and the body of a lambda) loop here instead of
+ * recursing, so they run in constant C stack. `frame` is the environment
+ * of the call to the lambda `fn` whose body is running; when that body
+ * tail-calls another lambda the callee's frame absorbs it, keeping the chain
+ * of environments at constant depth as well.
+ */
+static lval *lval_run(lenv *e, lval *f, int n, lval *v) {
+  lenv *frame = NULL;
+  lval *fn = NULL;
+  int pushed = 0;
+  for (;;) {
+    if (!f) {
+      if (v->type == LVAL_SYM) {
+        lval *x = lenv_get(e, v);
+        lval_del(v);
+        v = x;
+        break;
+      }
+      if (v->type != LVAL_SEXPR || v->count == 0) {
+        break;
+      }
+      v = lval_cells(e, v, &f, &n);
+      if (!f) {
+        break;
+      }
+    }
+
+    lbuiltin branch = f->builtin ? lval_tail_of(f->builtin) : NULL;
+    if (branch) {
+      v = branch(e, lstack_list(n));
+      lval_del(f);
+      f = NULL;
+      continue;
+    }
+    if (f->builtin) {
+      /* `profile` may start or stop the profiler inside the call. */
+      int prof = lprof_on;
+      if (prof) {
+        lprof_enter(f);
+      }
+      lval *x;
+      if (f->fast) {
+        x = f->fast(e, &lstack.vals[lstack.sp - n], n);
+        lstack_drop(n);
+      } else {
+        x = f->builtin(e, lstack_list(n));
+      }
+      if (prof) {
+        lprof_leave();
+      }
+      lval_del(f);
+      v = x;
+      break;
+    }
+
+    if (f->code->memo) {
+      v = lval_memo(e, f, lstack_list(n));
+      lval_del(f);
+      break;
+    }
+
+    lenv *env;
+    lval *g = lval_bind(f, &lstack.vals[lstack.sp - n], n, &env);
+    lstack_drop(n);
+    if (g) {
+      lval_del(f);
+      v = g;
+      break;
+    }
+    /* A tail call leaves the running lambda as the callee enters. */
+    if (pushed) {
+      lprof_leave();
+    }
+    pushed = lprof_on;
+    if (pushed) {
+      lprof_enter(f);
+    }
+    if (frame) {
+      lenv_merge(env, frame);
+      lenv_del(frame);
+      lval_del(fn);
+    } else {
+      env->par = e;
+    }
+    frame = env;
+    fn = f;
+    f = NULL;
+    e = env;
+    int at = lstack.sp;
+    v = lcode_run(e, fn->code, &f);
+    if (!f) {
+      break;
+    }
+    n = lstack.sp - at;
+  }
+
+  if (pushed) {
+    lprof_leave();
+  }
+  if (frame) {
+    lenv_del(frame);
+    lval_del(fn);
   }
   return v;
 }
+
+lval *lval_call(lenv *e, lval *f, lval *a) {
+  int n = a->count;
+  lstack_reserve(n);
+  for (int i = 0; i < n; i++) {
+    lstack.vals[lstack.sp++] = lval_copy(a->cell[i]);
+  }
+  lval_del(a);
+  return lval_apply(e, f, n);
+}
+
+lval *lval_apply(lenv *e, lval *f, int n) {
+  return lval_run(e, lval_copy(f), n, NULL);
+}
+
+lval *lval_eval(lenv *e, lval *v) { return lval_run(e, NULL, 0, v); }
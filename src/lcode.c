@@ -0,0 +1,619 @@
+#include <stdlib.h>
+
+#include "local-include/lcode.h"
+#include "local-include/lenv.h"
+#include "local-include/lmem.h"
+#include "local-include/lmemo.h"
+#include "local-include/lopt.h"
+#include "local-include/lprof.h"
+#include "local-include/lstack.h"
+#include "local-include/lsym.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+/* Direct-threaded dispatch where labels-as-values are available. */
+#if defined(__GNUC__)
+#define LCODE_THREADED
+#endif
+
+#define LCODE_MAX_LOCALS 16
+
+typedef struct {
+  lcode *c;
+  int cap;
+  int kcap;
+  int depth;
+  int nlocals;
+  char *locals[LCODE_MAX_LOCALS];
+  lopt *opt;
+} lcomp;
+
+static int lcomp_emit(lcomp *k, int word) {
+  lcode *c = k->c;
+  if (c->count == k->cap) {
+    k->cap = k->cap ? k->cap * 2 : 16;
+    c->code = realloc(c->code, sizeof(int) * k->cap);
+  }
+  c->code[c->count] = word;
+  return c->count++;
+}
+
+static int lcomp_const(lcomp *k, lval *v) {
+  lcode *c = k->c;
+  if (v->type == LVAL_SYM) {
+    for (int i = 0; i < c->nconst; i++) {
+      if (c->consts[i]->type == LVAL_SYM && c->consts[i]->sym == v->sym) {
+        return i;
+      }
+    }
+  }
+  if (c->nconst == k->kcap) {
+    k->kcap = k->kcap ? k->kcap * 2 : 8;
+    c->consts = realloc(c->consts, sizeof(lval *) * k->kcap);
+  }
+  c->consts[c->nconst] = v;
+  return c->nconst++;
+}
+
+static void lcomp_push(lcomp *k, int n) {
+  k->depth += n;
+  if (k->depth > k->c->depth) {
+    k->c->depth = k->depth;
+  }
+}
+
+static void lcomp_form(lcomp *k, lval **cells, int n, int tail);
+
+/*
+ * Formals are bound in order into the first slots of a fresh frame, so they
+ * can be addressed by slot. Give up on anything that would break that.
+ */
+static void lcomp_locals(lcomp *k, lval *formals) {
+  char *amp = lsym_intern("&");
+  k->nlocals = 0;
+  for (int i = 0; i < formals->count; i++) {
+    char *sym = formals->cell[i]->sym;
+    if (sym == amp) {
+      continue;
+    }
+    for (int j = 0; j < k->nlocals; j++) {
+      if (k->locals[j] == sym) {
+        k->nlocals = 0;
+        return;
+      }
+    }
+    if (k->nlocals == LCODE_MAX_LOCALS) {
+      return;
+    }
+    k->locals[k->nlocals++] = sym;
+  }
+}
+
+static void lcomp_expr(lcomp *k, lval *x) {
+  if (x->type == LVAL_SEXPR) {
+    lcomp_form(k, x->cell, x->count, 0);
+    return;
+  }
+  if (x->type == LVAL_SYM) {
+    for (int i = 0; i < k->nlocals; i++) {
+      if (k->locals[i] == x->sym) {
+        lcomp_emit(k, LOP_LOCAL);
+        lcomp_emit(k, i);
+        lcomp_emit(k, lcomp_const(k, x));
+        lcomp_push(k, 1);
+        return;
+      }
+    }
+  }
+  lcomp_emit(k, x->type == LVAL_SYM ? LOP_LOOKUP : LOP_CONST);
+  lcomp_emit(k, lcomp_const(k, x));
+  lcomp_push(k, 1);
+}
+
+static int lcomp_is_if(lval **cells, int n) {
+  static char *sym_if = NULL;
+  if (!sym_if) {
+    sym_if = lsym_intern("if");
+  }
+  return n == 4 && cells[0]->type == LVAL_SYM && cells[0]->sym == sym_if &&
+         cells[2]->type == LVAL_QEXPR && cells[3]->type == LVAL_QEXPR;
+}
+
+/* How the special forms are bound and named in errors. */
+static const struct {
+  char *name;
+  char *alias;
+  char *op;
+  lbuiltin builtin;
+} lcomp_forms[] = {
+    [LFORM_AND] = {"and", "&&", "&&", builtin_and},
+    [LFORM_OR] = {"or", "||", "||", builtin_or},
+    [LFORM_SELECT] = {"select", NULL, "select", builtin_select},
+    [LFORM_CASE] = {"case", NULL, "case", builtin_case},
+};
+
+static int lcomp_is_cases(lval **cells, int n) {
+  for (int i = 0; i < n; i++) {
+    if (cells[i]->type != LVAL_QEXPR || cells[i]->count < 2) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* The special form `cells` can be compiled as, or -1. */
+static int lcomp_special_of(lval **cells, int n) {
+  if (n == 0 || cells[0]->type != LVAL_SYM) {
+    return -1;
+  }
+  char *sym = cells[0]->sym;
+  int form = -1;
+  for (int i = 0; i < (int)(sizeof lcomp_forms / sizeof lcomp_forms[0]); i++) {
+    if (sym == lsym_intern(lcomp_forms[i].name) ||
+        (lcomp_forms[i].alias && sym == lsym_intern(lcomp_forms[i].alias))) {
+      form = i;
+    }
+  }
+  switch (form) {
+  case LFORM_AND:
+  case LFORM_OR:
+    return form;
+  case LFORM_SELECT:
+    return lcomp_is_cases(cells + 1, n - 1) ? form : -1;
+  case LFORM_CASE:
+    return n >= 2 && lcomp_is_cases(cells + 2, n - 2) ? form : -1;
+  }
+  return -1;
+}
+
+/* Emit a jump target to be filled in by `lcomp_patch`, chained through
+ * `*chain` with the other jumps to the same place. */
+static void lcomp_hole(lcomp *k, int *chain) { *chain = lcomp_emit(k, *chain); }
+
+static void lcomp_patch(lcomp *k, int chain) {
+  while (chain >= 0) {
+    int next = k->c->code[chain];
+    k->c->code[chain] = k->c->count;
+    chain = next;
+  }
+}
+
+/*
+ * A special form compiles to its inline code followed by the generic call,
+ * which runs when the operator turns out not to be bound to the builtin.
+ */
+static void lcomp_special(lcomp *k, lval **cells, int n, int tail, int form) {
+  int end = -1;
+  lcomp_expr(k, cells[0]);
+  lcomp_emit(k, LOP_FORM);
+  lcomp_emit(k, form);
+  int fallback = lcomp_emit(k, 0);
+  k->depth--;
+
+  if (form == LFORM_AND || form == LFORM_OR) {
+    for (int i = 1; i < n; i++) {
+      lcomp_expr(k, cells[i]);
+      k->depth--;
+      lcomp_emit(k, LOP_TEST);
+      lcomp_emit(k, form);
+      lcomp_emit(k, i - 1);
+      lcomp_emit(k, 0);
+      lcomp_hole(k, &end);
+    }
+    lcomp_emit(k, LOP_CONST);
+    lcomp_emit(k, lcomp_const(k, lval_num(form == LFORM_AND)));
+    lcomp_push(k, 1);
+  } else {
+    /* The value `case` compares against stays on the stack until a match. */
+    int first = 1;
+    if (form == LFORM_CASE) {
+      lcomp_expr(k, cells[1]);
+      lcomp_emit(k, LOP_ERROR);
+      lcomp_hole(k, &end);
+      first = 2;
+    }
+    for (int i = first; i < n; i++) {
+      int next = -1;
+      lcomp_form(k, cells[i]->cell, 1, 0);
+      if (form == LFORM_SELECT) {
+        lcomp_emit(k, LOP_TEST);
+        lcomp_emit(k, form);
+        lcomp_emit(k, i - 1);
+        k->depth--;
+      } else {
+        lcomp_emit(k, LOP_MATCH);
+        k->depth -= 2;
+      }
+      lcomp_hole(k, &next);
+      lcomp_hole(k, &end);
+      /* As `builtin_case_value` evaluates it. */
+      lval *v = cells[i]->cell[1];
+      if (v->type == LVAL_SEXPR) {
+        lcomp_form(k, v->cell, v->count, tail);
+      } else {
+        lcomp_form(k, cells[i]->cell + 1, 1, tail);
+      }
+      lcomp_emit(k, LOP_JUMP);
+      lcomp_hole(k, &end);
+      if (form == LFORM_SELECT) {
+        k->depth--;
+      }
+      lcomp_patch(k, next);
+    }
+    lcomp_emit(k, LOP_FAIL);
+    lcomp_emit(k, form);
+    if (form == LFORM_SELECT) {
+      lcomp_push(k, 1);
+    }
+  }
+  lcomp_emit(k, LOP_JUMP);
+  lcomp_hole(k, &end);
+
+  k->c->code[fallback] = k->c->count;
+  for (int i = 1; i < n; i++) {
+    lcomp_expr(k, cells[i]);
+  }
+  lcomp_emit(k, tail ? LOP_TAILCALL : LOP_CALL);
+  lcomp_emit(k, n);
+  k->depth -= n;
+  lcomp_push(k, 1);
+  lcomp_patch(k, end);
+}
+
+static void lcomp_call(lcomp *k, lval **cells, int n, int tail) {
+  int form = lcomp_special_of(cells, n);
+  if (form >= 0) {
+    lcomp_special(k, cells, n, tail, form);
+    return;
+  }
+  if (lcomp_is_if(cells, n)) {
+    lcomp_expr(k, cells[0]);
+    lcomp_expr(k, cells[1]);
+    int at = lcomp_emit(k, LOP_IF);
+    lcomp_emit(k, 0);
+    lcomp_emit(k, lcomp_const(k, cells[2]));
+    lcomp_emit(k, lcomp_const(k, cells[3]));
+    lcomp_emit(k, 0);
+    lcomp_emit(k, tail);
+    /* The generic fallback pushes both branches before calling `if`. */
+    lcomp_push(k, 2);
+    k->depth -= 4;
+
+    lcomp_form(k, cells[2]->cell, cells[2]->count, tail);
+    k->depth--;
+    lcomp_emit(k, LOP_JUMP);
+    int jump = lcomp_emit(k, 0);
+    k->c->code[at + 1] = k->c->count;
+    lcomp_form(k, cells[3]->cell, cells[3]->count, tail);
+    k->c->code[at + 4] = k->c->count;
+    k->c->code[jump] = k->c->count;
+    return;
+  }
+
+  for (int i = 0; i < n; i++) {
+    lcomp_expr(k, cells[i]);
+  }
+  lcomp_emit(k, tail ? LOP_TAILCALL : LOP_CALL);
+  lcomp_emit(k, n);
+  k->depth -= n;
+  lcomp_push(k, 1);
+}
+
+/*
+ * A form the optimizer rewrites compiles to the rewrite behind a guard,
+ * followed by the form as written for when the guard fails. The fallback is
+ * not optimized again, so nested rewrites do not multiply the code.
+ */
+static void lcomp_form(lcomp *k, lval **cells, int n, int tail) {
+  lopt *o = k->opt;
+  lval *x = o ? lopt_form(o, cells, n) : NULL;
+  if (!x) {
+    lcomp_call(k, cells, n, tail);
+    return;
+  }
+  lcomp_emit(k, LOP_GUARD);
+  int fallback = lcomp_emit(k, 0);
+  if (x->type == LVAL_SEXPR) {
+    lcomp_call(k, x->cell, x->count, tail);
+  } else {
+    lcomp_expr(k, x);
+  }
+  k->depth--;
+  lcomp_emit(k, LOP_JUMP);
+  int end = lcomp_emit(k, 0);
+  k->c->code[fallback] = k->c->count;
+  k->opt = NULL;
+  lcomp_call(k, cells, n, tail);
+  k->opt = o;
+  k->c->code[end] = k->c->count;
+}
+
+lcode *lcode_compile(lenv *e, lval *formals, lval *body) {
+  lcode *c = malloc(sizeof(lcode));
+  c->ref = 1;
+  c->count = 0;
+  c->code = NULL;
+  c->nconst = 0;
+  c->consts = NULL;
+  c->cache = NULL;
+  c->depth = 0;
+  c->name = NULL;
+  c->memo = NULL;
+  c->opt = NULL;
+  c->nguard = 0;
+  c->guards = NULL;
+  c->checked = 0;
+  c->valid = 0;
+
+  lopt o;
+  lcomp k = {c, 0, 0, 0, 0, {NULL}, NULL};
+  lenv *g = lopt_env(e);
+  if (g) {
+    lopt_init(&o, g, formals);
+    k.opt = &o;
+  }
+  lcomp_locals(&k, formals);
+  lcomp_form(&k, body->cell, body->count, 1);
+  lcomp_emit(&k, LOP_RET);
+
+  if (k.opt && o.keep->count) {
+    lval *assume = o.assume;
+    c->nguard = assume->count;
+    c->guards = malloc(sizeof(lguard) * assume->count);
+    for (int i = 0; i < assume->count; i++) {
+      c->guards[i].k = lcomp_const(&k, assume->cell[i]->cell[0]);
+      c->guards[i].val = assume->cell[i]->cell[1];
+    }
+    c->opt = lval_add(lval_add(lval_qexpr(), o.keep), assume);
+  } else if (k.opt) {
+    lopt_quit(&o);
+  }
+  c->cache = calloc(c->nconst, sizeof(lcache));
+  return c;
+}
+
+lcode *lcode_copy(lcode *c) {
+  c->ref++;
+  return c;
+}
+
+void lcode_del(lcode *c) {
+  if (--c->ref > 0) {
+    return;
+  }
+  if (c->memo) {
+    lmemo_del(c->memo);
+  }
+  if (c->opt) {
+    lval_del(c->opt);
+  }
+  free(c->guards);
+  free(c->code);
+  free(c->consts);
+  free(c->cache);
+  free(c);
+}
+
+/* Look the symbol constant `k` up, filling its cache from a global binding. */
+static lval *lcode_lookup(lenv *e, lcode *c, int k) {
+  lval *g;
+  lval *x = lenv_lookup(e, c->consts[k], &g);
+  if (g) {
+    c->cache[k].version = lenv_version;
+    c->cache[k].val = g;
+    lsym_set_cached(c->consts[k]->sym, lenv_version);
+  }
+  return x;
+}
+
+/*
+ * Check the symbols the rewrites rely on. The result holds for as long as
+ * `lenv_version` does, as the cached lookups themselves do.
+ */
+static int lcode_check(lenv *e, lcode *c) {
+  c->valid = 1;
+  for (int i = 0; i < c->nguard && c->valid; i++) {
+    int k = c->guards[i].k;
+    if (c->cache[k].version != lenv_version) {
+      lval_del(lcode_lookup(e, c, k));
+    }
+    c->valid = c->cache[k].version == lenv_version &&
+               c->cache[k].val == c->guards[i].val;
+  }
+  c->checked = lenv_version;
+  return c->valid;
+}
+
+lval *lcode_run(lenv *e, lcode *c, lval **f) {
+  lstack_reserve(c->depth);
+
+  /* Nested calls may move the stack, so it is always indexed afresh. */
+  int *code = c->code;
+  lval **consts = c->consts;
+  lcache *cache = c->cache;
+  int pc = 0;
+  int n, tail;
+  int prof = lprof_on;
+  lval *x;
+  *f = NULL;
+
+#ifdef LCODE_THREADED
+  static void *labels[] = {&&op_CONST, &&op_LOOKUP, &&op_LOCAL, &&op_CALL,
+                           &&op_TAILCALL, &&op_IF, &&op_FORM, &&op_TEST,
+                           &&op_MATCH, &&op_ERROR, &&op_FAIL, &&op_GUARD,
+                           &&op_JUMP, &&op_RET};
+#define OP(name) op_##name
+#define NEXT() goto *labels[code[pc++]]
+  NEXT();
+#else
+#define OP(name) case LOP_##name
+#define NEXT() goto next
+next:
+  switch (code[pc++]) {
+#endif
+
+  OP(CONST):
+    lstack.vals[lstack.sp++] = lval_copy(consts[code[pc++]]);
+    NEXT();
+
+  OP(LOOKUP): {
+    int k = code[pc++];
+    x = cache[k].version == lenv_version ? lval_copy(cache[k].val)
+                                         : lcode_lookup(e, c, k);
+    lstack.vals[lstack.sp++] = x;
+    NEXT();
+  }
+
+  OP(LOCAL): {
+    int i = code[pc++];
+    int k = code[pc++];
+    if (i < e->count && e->syms[i] == consts[k]->sym) {
+      x = lval_copy(e->vals[i]);
+    } else if (cache[k].version == lenv_version) {
+      x = lval_copy(cache[k].val);
+    } else {
+      x = lcode_lookup(e, c, k);
+    }
+    lstack.vals[lstack.sp++] = x;
+    NEXT();
+  }
+
+  OP(CALL):
+    n = code[pc++];
+    tail = 0;
+    goto call;
+
+  OP(TAILCALL):
+    n = code[pc++];
+    tail = 1;
+    goto call;
+
+  OP(IF): {
+    lval *fn = lstack.vals[lstack.sp - 2];
+    lval *cond = lstack.vals[lstack.sp - 1];
+    if (fn->type == LVAL_FUN && fn->builtin == builtin_if &&
+        cond->type == LVAL_NUM) {
+      pc = cond->num ? pc + 5 : code[pc];
+      lstack.sp -= 2;
+      lval_del(fn);
+      lval_del(cond);
+      NEXT();
+    }
+    lstack.vals[lstack.sp++] = lval_copy(consts[code[pc + 1]]);
+    lstack.vals[lstack.sp++] = lval_copy(consts[code[pc + 2]]);
+    n = 4;
+    tail = code[pc + 4];
+    pc = code[pc + 3];
+    goto call;
+  }
+
+  OP(FORM): {
+    lval *fn = lstack.vals[lstack.sp - 1];
+    if (fn->type == LVAL_FUN && fn->builtin == lcomp_forms[code[pc]].builtin) {
+      lstack.sp--;
+      lval_del(fn);
+      pc += 2;
+    } else {
+      pc = code[pc + 1];
+    }
+    NEXT();
+  }
+
+  OP(TEST): {
+    int form = code[pc];
+    x = lstack.vals[--lstack.sp];
+    lval *err = builtin_cond(x, lcomp_forms[form].op, code[pc + 1]);
+    int t = !err && x->num != 0;
+    lval_del(x);
+    if (err || (form != LFORM_SELECT && t == (form == LFORM_OR))) {
+      lstack.vals[lstack.sp++] = err ? err : lval_num(t);
+      pc = code[pc + 3];
+    } else {
+      pc = form == LFORM_SELECT && !t ? code[pc + 2] : pc + 4;
+    }
+    NEXT();
+  }
+
+  OP(MATCH): {
+    lval *key = lstack.vals[--lstack.sp];
+    x = lstack.vals[lstack.sp - 1];
+    if (key->type == LVAL_ERR) {
+      lval_del(x);
+      lstack.vals[lstack.sp - 1] = key;
+      pc = code[pc + 1];
+      NEXT();
+    }
+    int eq = lval_eq(x, key);
+    lval_del(key);
+    if (eq) {
+      lstack.sp--;
+      lval_del(x);
+      pc += 2;
+    } else {
+      pc = code[pc];
+    }
+    NEXT();
+  }
+
+  OP(ERROR):
+    pc = lstack.vals[lstack.sp - 1]->type == LVAL_ERR ? code[pc] : pc + 1;
+    NEXT();
+
+  OP(FAIL):
+    if (code[pc++] == LFORM_CASE) {
+      lval_del(lstack.vals[--lstack.sp]);
+      x = lval_err("No Case Found");
+    } else {
+      x = lval_err("No Selection Found");
+    }
+    lstack.vals[lstack.sp++] = x;
+    NEXT();
+
+  OP(GUARD):
+    if (!prof && (c->checked == lenv_version ? c->valid : lcode_check(e, c))) {
+      pc++;
+    } else {
+      pc = code[pc];
+    }
+    NEXT();
+
+  OP(JUMP):
+    pc = code[pc];
+    NEXT();
+
+  OP(RET):
+    x = lstack.vals[--lstack.sp];
+    return x;
+
+#ifndef LCODE_THREADED
+  }
+#endif
+#undef OP
+#undef NEXT
+
+call:
+  x = lval_form(n, f);
+  /* Nothing else of the body is on the stack at a tail call, so the
+   * arguments start where its values began. */
+  if (tail) {
+    return x;
+  }
+  if (*f) {
+    lval *fn = *f;
+    *f = NULL;
+    /* The profiler sees builtins called through lval_apply only. */
+    if (fn->builtin && fn->fast && !prof) {
+      x = fn->fast(e, &lstack.vals[lstack.sp - (n - 1)], n - 1);
+      lstack_drop(n - 1);
+    } else {
+      x = lval_apply(e, fn, n - 1);
+    }
+    lval_del(fn);
+  }
+  lstack.vals[lstack.sp++] = x;
+#ifdef LCODE_THREADED
+  goto *labels[code[pc++]];
+#else
+  goto next;
+#endif
+}
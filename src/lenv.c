@@ -4,59 +4,200 @@
 
 #include "local-include/common.h"
 #include "local-include/lenv.h"
+#include "local-include/lprof.h"
+#include "local-include/lstats.h"
+#include "local-include/lsym.h"
 #include "local-include/lval.h"
 #include <clisp.h>
 #include <mpc.h>
 
-lenv *lenv_new(void) {
+#define LENV_FLAT_MAX 8
+#define LENV_POOL_MAX 64
+
+/* Released frames, kept with their arrays for the next call to reuse. */
+static struct {
+  lenv *envs[LENV_POOL_MAX];
+  int count;
+} lenv_pool;
+
+unsigned long lenv_version = 1;
+
+static lenv *lenv_alloc(int global) {
   lenv *e = malloc(sizeof(lenv));
-  e->par = NULL;
+  e->global = global;
   e->count = 0;
+  e->cap = 0;
   e->syms = NULL;
   e->vals = NULL;
+  e->index = NULL;
+  e->mask = 0;
   return e;
 }
 
+static lenv *lenv_init(lenv *e) {
+  e->par = NULL;
+  e->ref = 1;
+  lstats.envs++;
+  if (++lstats.env_live > lstats.env_peak) {
+    lstats.env_peak = lstats.env_live;
+  }
+  return e;
+}
+
+lenv *lenv_new(void) { return lenv_init(lenv_alloc(1)); }
+
+lenv *lenv_frame(void) {
+  if (lenv_pool.count) {
+    return lenv_init(lenv_pool.envs[--lenv_pool.count]);
+  }
+  return lenv_init(lenv_alloc(0));
+}
+
 void lenv_del(lenv *e) {
+  if (--e->ref > 0) {
+    return;
+  }
+  lstats.env_live--;
   for (int i = 0; i < e->count; i++) {
-    free(e->syms[i]);
     lval_del(e->vals[i]);
   }
+  if (e->global) {
+    lenv_version++;
+  } else if (!e->index && lenv_pool.count < LENV_POOL_MAX) {
+    e->count = 0;
+    lenv_pool.envs[lenv_pool.count++] = e;
+    return;
+  }
   free(e->syms);
   free(e->vals);
+  free(e->index);
   free(e);
 }
 
-lval *lenv_get(lenv *e, lval *k) {
+void lenv_quit(void) {
+  while (lenv_pool.count) {
+    lenv *e = lenv_pool.envs[--lenv_pool.count];
+    free(e->syms);
+    free(e->vals);
+    free(e);
+  }
+}
+
+static void lenv_index_insert(lenv *e, int i) {
+  int j = lsym_hash(e->syms[i]) & e->mask;
+  while (e->index[j] >= 0) {
+    j = (j + 1) & e->mask;
+  }
+  e->index[j] = i;
+}
+
+static void lenv_index_build(lenv *e) {
+  int size = 16;
+  while (size * 3 < e->count * 4 + 4) {
+    size *= 2;
+  }
+  free(e->index);
+  e->index = malloc(sizeof(int) * size);
+  memset(e->index, -1, sizeof(int) * size);
+  e->mask = size - 1;
   for (int i = 0; i < e->count; i++) {
-    if (strcmp(e->syms[i], k->sym) == 0) {
-      return lval_copy(e->vals[i]);
+    lenv_index_insert(e, i);
+  }
+}
+
+static int lenv_find(lenv *e, char *sym) {
+  if (!e->index) {
+    for (int i = 0; i < e->count; i++) {
+      if (e->syms[i] == sym) {
+        return i;
+      }
     }
+    return -1;
   }
 
-  if (e->par) {
-    return lenv_get(e->par, k);
-  } else {
-    return lval_err("Unbound Symbol '%s'", k->sym);
+  int j = lsym_hash(sym) & e->mask;
+  while (e->index[j] >= 0) {
+    if (e->syms[e->index[j]] == sym) {
+      return e->index[j];
+    }
+    j = (j + 1) & e->mask;
   }
+  return -1;
 }
 
-void lenv_put(lenv *e, lval *k, lval *v) {
-  for (int i = 0; i < e->count; i++) {
-    if (strcmp(e->syms[i], k->sym) == 0) {
-      lval_del(e->vals[i]);
-      e->vals[i] = lval_copy(v);
-      return;
+lval *lenv_get(lenv *e, lval *k) {
+  for (; e; e = e->par) {
+    int i = lenv_find(e, k->sym);
+    if (i >= 0) {
+      return lval_copy(e->vals[i]);
+    }
+  }
+  return lval_err("Unbound Symbol '%s'", k->sym);
+}
+
+lval *lenv_lookup(lenv *e, lval *k, lval **global) {
+  *global = NULL;
+  for (; e; e = e->par) {
+    int i = lenv_find(e, k->sym);
+    if (i >= 0) {
+      if (e->global) {
+        *global = e->vals[i];
+      }
+      return lval_copy(e->vals[i]);
     }
   }
+  return lval_err("Unbound Symbol '%s'", k->sym);
+}
+
+void lenv_reserve(lenv *e, int n) {
+  if (e->cap < n) {
+    e->cap = n;
+    e->vals = realloc(e->vals, sizeof(lval *) * e->cap);
+    e->syms = realloc(e->syms, sizeof(char *) * e->cap);
+  }
+}
+
+static void lenv_append(lenv *e, char *sym, lval *v) {
+  /* A lookup cached as global since the last change goes stale once a frame
+   * shadows it; other frames leave the caches alone. */
+  if (e->global || lsym_cached(sym, lenv_version)) {
+    lenv_version++;
+  }
+  if (e->count == e->cap) {
+    e->cap = e->cap ? e->cap * 2 : 4;
+    e->vals = realloc(e->vals, sizeof(lval *) * e->cap);
+    e->syms = realloc(e->syms, sizeof(char *) * e->cap);
+  }
 
+  e->vals[e->count] = v;
+  e->syms[e->count] = sym;
   e->count++;
-  e->vals = realloc(e->vals, sizeof(lval *) * e->count);
-  e->syms = realloc(e->syms, sizeof(char *) * e->count);
 
-  e->vals[e->count - 1] = lval_copy(v);
-  e->syms[e->count - 1] = malloc(strlen(k->sym) + 1);
-  strcpy(e->syms[e->count - 1], k->sym);
+  if (e->index && e->count * 4 <= (e->mask + 1) * 3) {
+    lenv_index_insert(e, e->count - 1);
+  } else if (e->count > LENV_FLAT_MAX) {
+    lenv_index_build(e);
+  }
+}
+
+void lenv_put(lenv *e, lval *k, lval *v) {
+  int i = lenv_find(e, k->sym);
+  if (i >= 0) {
+    lval_del(e->vals[i]);
+    e->vals[i] = lval_copy(v);
+    lenv_version += e->global;
+    return;
+  }
+  lenv_append(e, k->sym, lval_copy(v));
+}
+
+void lenv_merge(lenv *e, lenv *from) {
+  for (int i = 0; i < from->count; i++) {
+    if (lenv_find(e, from->syms[i]) < 0) {
+      lenv_append(e, from->syms[i], lval_copy(from->vals[i]));
+    }
+  }
+  e->par = from->par;
 }
 
 void lenv_def(lenv *e, lval *k, lval *v) {
@@ -66,23 +207,18 @@ void lenv_def(lenv *e, lval *k, lval *v) {
   lenv_put(e, k, v);
 }
 
-lenv *lenv_copy(lenv *e) {
-  lenv *n = malloc(sizeof(lenv));
-  n->par = e->par;
-  n->count = e->count;
-  n->syms = malloc(sizeof(char *) * n->count);
-  n->vals = malloc(sizeof(lval *) * n->count);
-  for (int i = 0; i < e->count; i++) {
-    n->syms[i] = malloc(strlen(e->syms[i]) + 1);
-    strcpy(n->syms[i], e->syms[i]);
-    n->vals[i] = lval_copy(e->vals[i]);
-  }
-  return n;
+lenv *lenv_share(lenv *e) {
+  lstats.env_shares++;
+  e->ref++;
+  return e;
 }
 
-void lenv_add_builtin(lenv *e, char *name, lbuiltin func) {
+void lenv_add_builtin(lenv *e, char *name, lbuiltin func,
+                      lbuiltin_fast fast) {
   lval *k = lval_sym(name);
   lval *v = lval_fun(func);
+  v->fast = fast;
+  lprof_name(v, k->sym);
   lenv_put(e, k, v);
   lval_del(k);
   lval_del(v);
@@ -92,6 +228,7 @@ void lenv_add_builtins(lenv *e) {
   const struct {
     char *name;
     lbuiltin func;
+    lbuiltin_fast fast;
   } builtins[] = {
       /* List Functions */
       {"list", builtin_list},
@@ -102,6 +239,29 @@ void lenv_add_builtins(lenv *e) {
       {"cons", builtin_cons},
       {"len", builtin_len},
       {"init", builtin_init},
+      {"nth", builtin_nth},
+      {"last", builtin_last},
+      {"take", builtin_take},
+      {"drop", builtin_drop},
+      {"split", builtin_split},
+      {"elem", builtin_elem},
+      {"map", builtin_map},
+      {"filter", builtin_filter},
+      {"foldl", builtin_foldl},
+      {"sum", builtin_sum},
+      {"product", builtin_product},
+      {"vec", builtin_vec},
+      {"vec-list", builtin_vec_list},
+      {"vec-range", builtin_vec_range},
+      {"vec-len", builtin_vec_len},
+      {"vec-slice", builtin_vec_slice},
+      {"vec+", builtin_vec_add},
+      {"vec*", builtin_vec_mul},
+      {"vec-dot", builtin_vec_dot},
+      {"vec-sum", builtin_vec_sum},
+      {"vec-min", builtin_vec_min},
+      {"vec-max", builtin_vec_max},
+      {"vec-scan", builtin_vec_scan},
       {"def", builtin_def},
       {"=", builtin_put},
       {"\\", builtin_lambda},
@@ -110,28 +270,37 @@ void lenv_add_builtins(lenv *e) {
       {"load", builtin_load},
       {"print", builtin_print},
       {"error", builtin_error},
+      {"profile", builtin_profile},
+      {"mem-stats", builtin_mem_stats},
+      {"memo", builtin_memo},
+      {"memo-stats", builtin_memo_stats},
       /* Mathematical Functions */
-      {"+", builtin_add},
-      {"-", builtin_sub},
-      {"*", builtin_mul},
-      {"/", builtin_div},
+      {"+", builtin_add, builtin_add_fast},
+      {"-", builtin_sub, builtin_sub_fast},
+      {"*", builtin_mul, builtin_mul_fast},
+      {"/", builtin_div, builtin_div_fast},
       /* Comparison Functions */
       {"if", builtin_if},
-      {"==", builtin_eq},
-      {"!=", builtin_ne},
-      {">", builtin_gt},
-      {"<", builtin_lt},
-      {">=", builtin_ge},
-      {"<=", builtin_le},
+      {"select", builtin_select},
+      {"case", builtin_case},
+      {"do", builtin_do},
+      {"let", builtin_let},
+      {"==", builtin_eq, builtin_eq_fast},
+      {"!=", builtin_ne, builtin_ne_fast},
+      {">", builtin_gt, builtin_gt_fast},
+      {"<", builtin_lt, builtin_lt_fast},
+      {">=", builtin_ge, builtin_ge_fast},
+      {"<=", builtin_le, builtin_le_fast},
       {"and", builtin_and},
       {"&&", builtin_and},
       {"or", builtin_or},
       {"||", builtin_or},
-      {"not", builtin_not},
-      {"!", builtin_not},
+      {"not", builtin_not, builtin_not_fast},
+      {"!", builtin_not, builtin_not_fast},
   };
   const int builtin_count = (sizeof builtins) / (sizeof builtins[0]);
   for (int i = 0; i < builtin_count; i++) {
-    lenv_add_builtin(e, builtins[i].name, builtins[i].func);
+    lenv_add_builtin(e, builtins[i].name, builtins[i].func,
+                     builtins[i].fast);
   }
 }
@@ -0,0 +1,322 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "local-include/lenv.h"
+#include "local-include/lgc.h"
+#include "local-include/lmem.h"
+#include "local-include/lprof.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+#define LGC_GENS 3
+#define LGC_YOUNG_THRESHOLD 700
+#define LGC_MIDDLE_EVERY 10
+#define LGC_OLD_EVERY 10
+#define LGC_BUCKETS 24
+
+enum { LGC_UNTRACKED = -1, LGC_COLLECTING = LGC_GENS, LGC_UNREACHABLE };
+
+typedef struct lgc_head lgc_head;
+struct lgc_head {
+  lgc_head *next;
+  lgc_head *prev;
+  int gen;
+  int refs;
+};
+
+#define LGC_HEAD_SIZE                                                          \
+  ((sizeof(lgc_head) + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *))
+
+static struct {
+  int enabled;
+  int collecting;
+  lgc_head gens[LGC_GENS];
+  int count[LGC_GENS];
+  int young_runs;
+  int middle_runs;
+  /* Statistics */
+  long runs[LGC_GENS];
+  long freed;
+  long scanned;
+  long buckets[LGC_BUCKETS];
+  double pause_total;
+  double pause_max;
+} lgc;
+
+static lgc_head *lgc_head_of(lval *v) {
+  return (lgc_head *)((char *)v - LGC_HEAD_SIZE);
+}
+
+static lval *lgc_lval_of(lgc_head *h) {
+  return (lval *)((char *)h + LGC_HEAD_SIZE);
+}
+
+static void lgc_list_init(lgc_head *l) { l->next = l->prev = l; }
+
+static void lgc_list_remove(lgc_head *h) {
+  h->prev->next = h->next;
+  h->next->prev = h->prev;
+}
+
+static void lgc_list_append(lgc_head *l, lgc_head *h) {
+  h->prev = l->prev;
+  h->next = l;
+  l->prev->next = h;
+  l->prev = h;
+}
+
+static void lgc_list_splice(lgc_head *to, lgc_head *from) {
+  if (from->next == from) {
+    return;
+  }
+  from->next->prev = to->prev;
+  to->prev->next = from->next;
+  from->prev->next = to;
+  to->prev = from->prev;
+  lgc_list_init(from);
+}
+
+static int lgc_is_container(lval *v) {
+  return v->type == LVAL_SEXPR || v->type == LVAL_QEXPR ||
+         (v->type == LVAL_FUN && !v->builtin);
+}
+
+void lgc_enable(void) {
+  lgc.enabled = 1;
+  for (int i = 0; i < LGC_GENS; i++) {
+    lgc_list_init(&lgc.gens[i]);
+  }
+}
+
+lval *lgc_alloc(void) {
+  if (lprof_on) {
+    lprof_alloc();
+  }
+  if (!lgc.enabled) {
+    return lmem_alloc(sizeof(lval));
+  }
+  if (lgc.count[0] > LGC_YOUNG_THRESHOLD && !lgc.collecting) {
+    int gen = 0;
+    if (++lgc.young_runs % LGC_MIDDLE_EVERY == 0) {
+      gen = ++lgc.middle_runs % LGC_OLD_EVERY == 0 ? 2 : 1;
+    }
+    lgc_collect(gen);
+  }
+  lgc_head *h = lmem_alloc(LGC_HEAD_SIZE + sizeof(lval));
+  h->gen = LGC_UNTRACKED;
+  return lgc_lval_of(h);
+}
+
+void lgc_free(lval *v) {
+  if (!lgc.enabled) {
+    lmem_free(v, sizeof(lval));
+    return;
+  }
+  lgc_head *h = lgc_head_of(v);
+  if (h->gen != LGC_UNTRACKED) {
+    lgc_list_remove(h);
+    if (h->gen < LGC_GENS) {
+      lgc.count[h->gen]--;
+    }
+  }
+  lmem_free(h, LGC_HEAD_SIZE + sizeof(lval));
+}
+
+void lgc_track(lval *v) {
+  if (!lgc.enabled || !lgc_is_container(v)) {
+    return;
+  }
+  lgc_head *h = lgc_head_of(v);
+  h->gen = 0;
+  lgc_list_append(&lgc.gens[0], h);
+  lgc.count[0]++;
+}
+
+static void lgc_traverse(lval *v, void (*visit)(lval *, void *), void *arg) {
+  switch (v->type) {
+  case LVAL_SEXPR:
+  case LVAL_QEXPR:
+    if (v->base) {
+      visit(v->base, arg);
+      break;
+    }
+    for (int i = 0; i < v->count; i++) {
+      /* the evaluator leaves a hole while a cell is being evaluated */
+      if (v->cell[i]) {
+        visit(v->cell[i], arg);
+      }
+    }
+    break;
+  case LVAL_FUN:
+    if (!v->builtin) {
+      /* A shared environment's references count as external ones. */
+      for (int i = 0; v->env && v->env->ref == 1 && i < v->env->count; i++) {
+        visit(v->env->vals[i], arg);
+      }
+      visit(v->formals, arg);
+      visit(v->body, arg);
+    }
+    break;
+  }
+}
+
+static lgc_head *lgc_tracked(lval *v) {
+  if (!lgc_is_container(v)) {
+    return NULL;
+  }
+  lgc_head *h = lgc_head_of(v);
+  return h->gen == LGC_UNTRACKED ? NULL : h;
+}
+
+static void lgc_visit_decref(lval *v, void *arg) {
+  lgc_head *h = lgc_tracked(v);
+  if (h && h->gen == LGC_COLLECTING) {
+    h->refs--;
+  }
+}
+
+static void lgc_visit_reach(lval *v, void *arg) {
+  lgc_head *h = lgc_tracked(v);
+  if (h && h->gen == LGC_UNREACHABLE) {
+    lgc_list_remove(h);
+    lgc_list_append(arg, h);
+    h->gen = LGC_COLLECTING;
+  }
+}
+
+static void lgc_clear(lval *v) {
+  switch (v->type) {
+  case LVAL_SEXPR:
+  case LVAL_QEXPR:
+    lval_clear(v);
+    break;
+  case LVAL_FUN:
+    if (!v->builtin && v->env) {
+      lenv_del(v->env);
+      v->env = NULL;
+    }
+    break;
+  }
+}
+
+static void lgc_record_pause(double us) {
+  int b = 0;
+  while (b < LGC_BUCKETS - 1 && us >= (double)(1L << b)) {
+    b++;
+  }
+  lgc.buckets[b]++;
+  lgc.pause_total += us;
+  if (us > lgc.pause_max) {
+    lgc.pause_max = us;
+  }
+}
+
+int lgc_collect(int gen) {
+  if (!lgc.enabled || lgc.collecting) {
+    return 0;
+  }
+  lgc.collecting = 1;
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  lgc_head set, unreachable;
+  lgc_list_init(&set);
+  lgc_list_init(&unreachable);
+
+  /* References from older generations count as external ones, so a cycle
+   * reaching into them waits for the collection of their generation. */
+  gen = gen < LGC_GENS ? gen : LGC_GENS - 1;
+  for (int i = 0; i <= gen; i++) {
+    lgc_list_splice(&set, &lgc.gens[i]);
+    lgc.count[i] = 0;
+  }
+  for (lgc_head *h = set.next; h != &set; h = h->next) {
+    h->gen = LGC_COLLECTING;
+  }
+
+  /* Trial deletion: whatever is left in refs is referenced from outside. */
+  long scanned = 0;
+  for (lgc_head *h = set.next; h != &set; h = h->next) {
+    h->refs = lgc_lval_of(h)->ref;
+    scanned++;
+  }
+  for (lgc_head *h = set.next; h != &set; h = h->next) {
+    lgc_traverse(lgc_lval_of(h), lgc_visit_decref, NULL);
+  }
+  for (lgc_head *h = set.next, *next; h != &set; h = next) {
+    next = h->next;
+    if (h->refs <= 0) {
+      lgc_list_remove(h);
+      lgc_list_append(&unreachable, h);
+      h->gen = LGC_UNREACHABLE;
+    }
+  }
+  for (lgc_head *h = set.next; h != &set; h = h->next) {
+    lgc_traverse(lgc_lval_of(h), lgc_visit_reach, &set);
+  }
+
+  /* Survivors are promoted. */
+  int target = gen + 1 < LGC_GENS ? gen + 1 : LGC_GENS - 1;
+  for (lgc_head *h = set.next; h != &set; h = h->next) {
+    h->gen = target;
+    lgc.count[target]++;
+  }
+  lgc_list_splice(&lgc.gens[target], &set);
+
+  /* Break the cycles: hold every object, drop their contents, release. */
+  int n = 0;
+  for (lgc_head *h = unreachable.next; h != &unreachable; h = h->next) {
+    lgc_lval_of(h)->ref++;
+    n++;
+  }
+  lval **dead = malloc(sizeof(lval *) * (n ? n : 1));
+  int i = 0;
+  for (lgc_head *h = unreachable.next; h != &unreachable; h = h->next) {
+    dead[i++] = lgc_lval_of(h);
+  }
+  for (i = 0; i < n; i++) {
+    lgc_clear(dead[i]);
+  }
+  for (i = 0; i < n; i++) {
+    lval_del(dead[i]);
+  }
+  free(dead);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  lgc_record_pause((t1.tv_sec - t0.tv_sec) * 1e6 +
+                   (t1.tv_nsec - t0.tv_nsec) / 1e3);
+  lgc.runs[gen]++;
+  lgc.freed += n;
+  lgc.scanned += scanned;
+  lgc.collecting = 0;
+  return n;
+}
+
+void lgc_report(void) {
+  if (!lgc.enabled) {
+    return;
+  }
+  long runs = 0;
+  for (int i = 0; i < LGC_GENS; i++) {
+    runs += lgc.runs[i];
+  }
+  printf("gc: %ld collections (young %ld, middle %ld, full %ld)\n", runs,
+         lgc.runs[0], lgc.runs[1], lgc.runs[2]);
+  printf("gc: %ld objects scanned, %ld freed, %d/%d/%d tracked\n",
+         lgc.scanned, lgc.freed, lgc.count[0], lgc.count[1], lgc.count[2]);
+  if (runs == 0) {
+    return;
+  }
+  printf("gc: pause total %.1fus, mean %.1fus, max %.1fus\n", lgc.pause_total,
+         lgc.pause_total / runs, lgc.pause_max);
+  for (int b = 0; b < LGC_BUCKETS; b++) {
+    if (lgc.buckets[b]) {
+      printf("gc:   < %8ldus %ld\n", 1L << b, lgc.buckets[b]);
+    }
+  }
+}
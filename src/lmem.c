@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "local-include/lmem.h"
+#include <clisp.h>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define LMEM_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define LMEM_ASAN
+#endif
+#endif
+
+/* Keep use-after-free detection working for blocks recycled by the slabs. */
+#ifdef LMEM_ASAN
+#include <sanitizer/asan_interface.h>
+#define LMEM_POISON(p, n) ASAN_POISON_MEMORY_REGION(p, n)
+#define LMEM_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION(p, n)
+#else
+#define LMEM_POISON(p, n) ((void)(p), (void)(n))
+#define LMEM_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
+#define LMEM_SLAB_SIZE (64 * 1024)
+#define LMEM_ALIGN 16
+#define LMEM_KEEP_EMPTY 1
+
+static const size_t lmem_sizes[] = {16, 32, 48, 64, 96, 128, 192, 256};
+#define LMEM_CLASSES ((int)(sizeof lmem_sizes / sizeof lmem_sizes[0]))
+
+typedef struct lslab lslab;
+struct lslab {
+  lslab *next;
+  lslab *prev;
+  lslab *all_next;
+  lslab *all_prev;
+  int cls;
+  int live;
+  int listed;
+  void *free;
+  char *bump;
+  char *end;
+};
+
+#define LMEM_HEADER                                                            \
+  ((sizeof(lslab) + LMEM_ALIGN - 1) / LMEM_ALIGN * LMEM_ALIGN)
+
+static struct {
+  lslab *partial[LMEM_CLASSES];
+  int empty[LMEM_CLASSES];
+  lslab *all;
+  size_t allocs;
+} lmem;
+
+static int lmem_class(size_t size) {
+  static const unsigned char index[LMEM_SMALL_MAX / LMEM_ALIGN + 1] = {
+      0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+  return index[(size + LMEM_ALIGN - 1) / LMEM_ALIGN];
+}
+
+static lslab *lmem_slab_of(void *p) {
+  return (lslab *)((uintptr_t)p & ~(uintptr_t)(LMEM_SLAB_SIZE - 1));
+}
+
+static void lmem_link(lslab *s) {
+  s->prev = NULL;
+  s->next = lmem.partial[s->cls];
+  if (s->next) {
+    s->next->prev = s;
+  }
+  lmem.partial[s->cls] = s;
+  s->listed = 1;
+}
+
+static void lmem_unlink(lslab *s) {
+  if (s->prev) {
+    s->prev->next = s->next;
+  } else {
+    lmem.partial[s->cls] = s->next;
+  }
+  if (s->next) {
+    s->next->prev = s->prev;
+  }
+  s->listed = 0;
+}
+
+static lslab *lmem_slab_new(int cls) {
+  lslab *s = aligned_alloc(LMEM_SLAB_SIZE, LMEM_SLAB_SIZE);
+  if (!s) {
+    return NULL;
+  }
+  s->cls = cls;
+  s->live = 0;
+  s->free = NULL;
+  s->bump = (char *)s + LMEM_HEADER;
+  s->end = (char *)s + LMEM_SLAB_SIZE;
+  s->all_prev = NULL;
+  s->all_next = lmem.all;
+  if (s->all_next) {
+    s->all_next->all_prev = s;
+  }
+  lmem.all = s;
+  LMEM_POISON(s->bump, s->end - s->bump);
+  lmem_link(s);
+  lmem.empty[cls]++;
+  return s;
+}
+
+static void lmem_slab_del(lslab *s) {
+  if (s->all_prev) {
+    s->all_prev->all_next = s->all_next;
+  } else {
+    lmem.all = s->all_next;
+  }
+  if (s->all_next) {
+    s->all_next->all_prev = s->all_prev;
+  }
+  LMEM_UNPOISON(s, LMEM_SLAB_SIZE);
+  free(s);
+}
+
+void *lmem_alloc(size_t size) {
+  if (size == 0) {
+    return NULL;
+  }
+  lmem.allocs++;
+  if (size > LMEM_SMALL_MAX) {
+    return malloc(size);
+  }
+
+  int cls = lmem_class(size);
+  lslab *s = lmem.partial[cls];
+  if (!s && !(s = lmem_slab_new(cls))) {
+    return NULL;
+  }
+
+  void *p;
+  if (s->free) {
+    p = s->free;
+    LMEM_UNPOISON(p, lmem_sizes[cls]);
+    s->free = *(void **)p;
+  } else {
+    p = s->bump;
+    s->bump += lmem_sizes[cls];
+    LMEM_UNPOISON(p, lmem_sizes[cls]);
+  }
+
+  if (s->live++ == 0) {
+    lmem.empty[cls]--;
+  }
+  if (!s->free && s->bump + lmem_sizes[cls] > s->end) {
+    lmem_unlink(s);
+  }
+  return p;
+}
+
+void lmem_free(void *p, size_t size) {
+  if (!p) {
+    return;
+  }
+  if (size > LMEM_SMALL_MAX) {
+    free(p);
+    return;
+  }
+
+  lslab *s = lmem_slab_of(p);
+  *(void **)p = s->free;
+  s->free = p;
+  LMEM_POISON(p, lmem_sizes[s->cls]);
+
+  if (!s->listed) {
+    lmem_link(s);
+  }
+  if (--s->live == 0) {
+    lmem.empty[s->cls]++;
+  }
+}
+
+void *lmem_realloc(void *p, size_t old_size, size_t new_size) {
+  if (!p) {
+    return lmem_alloc(new_size);
+  }
+  if (new_size == 0) {
+    lmem_free(p, old_size);
+    return NULL;
+  }
+  if (old_size > LMEM_SMALL_MAX && new_size > LMEM_SMALL_MAX) {
+    return realloc(p, new_size);
+  }
+  if (old_size <= LMEM_SMALL_MAX && new_size <= LMEM_SMALL_MAX &&
+      lmem_class(old_size) == lmem_class(new_size)) {
+    return p;
+  }
+
+  void *n = lmem_alloc(new_size);
+  memcpy(n, p, old_size < new_size ? old_size : new_size);
+  lmem_free(p, old_size);
+  return n;
+}
+
+size_t lmem_allocs(void) { return lmem.allocs; }
+
+void lmem_reset(void) {
+  for (int cls = 0; cls < LMEM_CLASSES; cls++) {
+    lslab *s = lmem.partial[cls];
+    while (s && lmem.empty[cls] > LMEM_KEEP_EMPTY) {
+      lslab *next = s->next;
+      if (s->live == 0) {
+        lmem_unlink(s);
+        lmem_slab_del(s);
+        lmem.empty[cls]--;
+      }
+      s = next;
+    }
+  }
+}
+
+void lmem_quit(void) {
+  while (lmem.all) {
+    lslab *s = lmem.all;
+    lmem.all = s->all_next;
+    LMEM_UNPOISON(s, LMEM_SLAB_SIZE);
+    free(s);
+  }
+  memset(&lmem, 0, sizeof lmem);
+}
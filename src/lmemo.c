@@ -0,0 +1,153 @@
+#include <stdlib.h>
+
+#include "local-include/lmem.h"
+#include "local-include/lmemo.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+typedef struct lmemo_entry lmemo_entry;
+struct lmemo_entry {
+  lval *key;
+  lval *val;
+  unsigned long hash;
+  lmemo_entry *chain;
+  /* Recency list, most recently used first. */
+  lmemo_entry *prev;
+  lmemo_entry *next;
+};
+
+struct lmemo {
+  lmemo_entry **buckets;
+  int mask;
+  int count;
+  int cap;
+  lmemo_entry *head;
+  lmemo_entry *tail;
+  long hits;
+  long misses;
+  long evictions;
+};
+
+lmemo *lmemo_new(int cap) {
+  lmemo *m = calloc(1, sizeof(lmemo));
+  m->mask = 15;
+  m->buckets = calloc(m->mask + 1, sizeof(lmemo_entry *));
+  m->cap = cap;
+  return m;
+}
+
+void lmemo_del(lmemo *m) {
+  for (lmemo_entry *x = m->head; x;) {
+    lmemo_entry *next = x->next;
+    lval_del(x->key);
+    lval_del(x->val);
+    lmem_free(x, sizeof(lmemo_entry));
+    x = next;
+  }
+  free(m->buckets);
+  free(m);
+}
+
+static void lmemo_unlink(lmemo *m, lmemo_entry *x) {
+  *(x->prev ? &x->prev->next : &m->head) = x->next;
+  *(x->next ? &x->next->prev : &m->tail) = x->prev;
+}
+
+static void lmemo_push(lmemo *m, lmemo_entry *x) {
+  x->prev = NULL;
+  x->next = m->head;
+  *(m->head ? &m->head->prev : &m->tail) = x;
+  m->head = x;
+}
+
+static lmemo_entry *lmemo_find(lmemo *m, lval *key, unsigned long h) {
+  for (lmemo_entry *x = m->buckets[h & m->mask]; x; x = x->chain) {
+    if (x->hash == h && lval_eq(x->key, key)) {
+      return x;
+    }
+  }
+  return NULL;
+}
+
+static void lmemo_grow(lmemo *m) {
+  int size = (m->mask + 1) * 2;
+  lmemo_entry **buckets = calloc(size, sizeof(lmemo_entry *));
+  for (lmemo_entry *x = m->head; x; x = x->next) {
+    lmemo_entry **b = &buckets[x->hash & (size - 1)];
+    x->chain = *b;
+    *b = x;
+  }
+  free(m->buckets);
+  m->buckets = buckets;
+  m->mask = size - 1;
+}
+
+static void lmemo_evict(lmemo *m) {
+  lmemo_entry *x = m->tail;
+  lmemo_entry **b = &m->buckets[x->hash & m->mask];
+  while (*b != x) {
+    b = &(*b)->chain;
+  }
+  *b = x->chain;
+  lmemo_unlink(m, x);
+  lval_del(x->key);
+  lval_del(x->val);
+  lmem_free(x, sizeof(lmemo_entry));
+  m->count--;
+  m->evictions++;
+}
+
+lval *lmemo_get(lmemo *m, lval *key) {
+  lmemo_entry *x = lmemo_find(m, key, lval_hash(key));
+  if (!x) {
+    m->misses++;
+    return NULL;
+  }
+  m->hits++;
+  if (x != m->head) {
+    lmemo_unlink(m, x);
+    lmemo_push(m, x);
+  }
+  return lval_copy(x->val);
+}
+
+void lmemo_put(lmemo *m, lval *key, lval *val) {
+  unsigned long h = lval_hash(key);
+  /* The key may have been stored by a call nested inside its own. */
+  lmemo_entry *x = lmemo_find(m, key, h);
+  if (x) {
+    lval_del(x->val);
+    x->val = lval_copy(val);
+    return;
+  }
+
+  if (m->count == m->cap) {
+    lmemo_evict(m);
+  }
+  if (m->count > m->mask) {
+    lmemo_grow(m);
+  }
+  x = lmem_alloc(sizeof(lmemo_entry));
+  x->key = lval_copy(key);
+  x->val = lval_copy(val);
+  x->hash = h;
+  x->chain = m->buckets[h & m->mask];
+  m->buckets[h & m->mask] = x;
+  lmemo_push(m, x);
+  m->count++;
+}
+
+static lval *lmemo_pair(lval *x, const char *name, long n) {
+  lval *p = lval_add(lval_qexpr(), lval_sym((char *)name));
+  return lval_add(x, lval_add(p, lval_num(n)));
+}
+
+lval *lmemo_list(lmemo *m) {
+  lval *x = lval_qexpr();
+  x = lmemo_pair(x, "hits", m->hits);
+  x = lmemo_pair(x, "misses", m->misses);
+  x = lmemo_pair(x, "size", m->count);
+  x = lmemo_pair(x, "cap", m->cap);
+  x = lmemo_pair(x, "evictions", m->evictions);
+  return x;
+}
@@ -14,6 +14,8 @@
  */
 typedef struct lval lval;
 typedef struct lenv lenv;
+typedef struct lcode lcode;
+typedef struct lmemo lmemo;
 
 extern mpc_parser_t *Number;
 extern mpc_parser_t *Symbol;
@@ -33,6 +35,7 @@ extern mpc_parser_t *Lispy;
  * LVAL_FUN: 函数类型。
  * LVAL_SEXPR: S表达式类型。
  * LVAL_QEXPR: Q表达式类型。
+ * LVAL_VEC: 数值向量类型。
  */
 enum {
   LVAL_ERR,
@@ -41,7 +44,8 @@ enum {
   LVAL_STR,
   LVAL_FUN,
   LVAL_SEXPR,
-  LVAL_QEXPR
+  LVAL_QEXPR,
+  LVAL_VEC
 };
 
 /*
@@ -49,6 +53,15 @@ enum {
  * 如果你不熟悉 typedef 或函数指针，STFW & RTFM
  */
 typedef lval *(*lbuiltin)(lenv *, lval *);
+/*
+ * 声明 lbuiltin_fast 类型，内置函数的快速路径。
+ * 参数不再组成参数列表，而是求值器值栈上连续的 n 个值（见 `lstack`），
+ * 以起始地址和个数传入。函数只借用这些参数，不修改也不释放它们，
+ * 由调用者在调用结束后释放。
+ * 提供快速路径的内置函数调用时不需要构造参数列表，也就不需要分配内存。
+ * 快速路径中不能再求值任何表达式，否则值栈可能被移动，参数的地址随之失效。
+ */
+typedef lval *(*lbuiltin_fast)(lenv *, lval **, int);
 
 /*
  * 声明 lval 结构体，表示 lisp 值。
@@ -56,16 +69,44 @@ typedef lval *(*lbuiltin)(lenv *, lval *);
  * 该结构体根据不同类型的值使用不同的存储方式。
  * - type == LVAL_ERR: 使用 err 存储错误信息。
  * - type == LVAL_NUM: 使用 num 存储数值。
- * - type == LVAL_SYM: 使用 sym 存储符号。
+ * - type == LVAL_SYM: 使用 sym 存储符号，sym 是驻留后的规范指针，
+ *   由驻留表持有，可以直接用 == 比较。
  * - type == LVAL_STR: 使用 str 存储字符串。
  * - type == LVAL_SEXPR 或 LVAL_QEXPR: 使用 cell 数组存储表达式。
+ *   cell 指向第一个元素，共 count 个元素；数组共分配 cap 个槽位，
+ *   第一个元素之前空闲 off 个槽位，即数组的起始位置为 cell - off。
+ *   数组按倍数增长，因此在两端添加、从开头移除元素均摊为 O(1)。
+ *   如果 base 不为 NULL，该表达式是一个视图：cell 指向 base 的数组中的一段，
+ *   元素由 base 持有，视图只持有 base 的一个引用（此时 cap 和 off 无意义）。
+ *   base 是不对外可见的表达式，只被视图共享，`tail` 等操作借此共享结构而不复制元素。
+ *   hash 缓存 `lval_hash` 计算的结构哈希值，0 表示尚未计算，
+ *   任何修改表达式的操作都会将其清零。
+ * - type == LVAL_VEC: 使用 vec 存储 len 个连续排列的数值，
+ *   元素不是 lval，没有引用计数，批量运算可以直接使用 SIMD 指令。
+ *   len 为 0 时 vec 为 NULL。
  * - type == LVAL_FUN:
- *   - 如果 builtin 不为 NULL，表示为内置函数。
+ *   - 如果 builtin 不为 NULL，表示为内置函数，fast 为其快速路径，没有时为 NULL。
  *   - 如果 builtin 为 NULL，表示为用户定义的 lambda 函数，
- *     其中 env 为函数环境，formals 为参数列表，body 为函数体。
+ *     其中 formals 为参数列表，body 为函数体，
+ *     code 为定义时由 body 编译得到的字节码。
+ *     env 为部分应用时已经绑定的参数组成的环境，没有时为 NULL。
+ *     该环境创建后不再修改，函数的副本共享同一个环境；
+ *     每次调用另建一个新的帧，先放入 env 中的绑定，再绑定本次的参数。
+ *
+ * ref 为引用计数。lval 可以被多处共享（环境中的绑定、表达式的元素等），
+ * 每个持有者拥有一个引用，`lval_del` 释放引用，计数归零时才真正释放。
+ * 共享的 lval 视为不可变，需要修改时先用 `lval_mut` 取得独占的版本。
+ * 小整数（LVAL_SMALL_MIN 到 LVAL_SMALL_MAX）和符号各只有一个永久的 lval，
+ * 由 `lval_num` 和 `lval_sym` 共享返回，其引用计数从 LVAL_IMMORTAL 开始，
+ * 永远不会归零，因此创建和释放它们都不需要分配内存。
  */
+#define LVAL_IMMORTAL (1 << 30)
+#define LVAL_SMALL_MIN (-256)
+#define LVAL_SMALL_MAX 1023
+
 typedef struct lval {
   int type;
+  int ref;
   union {
     long num;
     char *err;
@@ -73,13 +114,27 @@ typedef struct lval {
     char *str;
     struct {
       int count;
+      int cap;
+      int off;
+      unsigned hash;
       struct lval **cell;
+      struct lval *base;
+    };
+    struct {
+      int len;
+      long *vec;
     };
     struct {
       lbuiltin builtin;
-      lenv *env;
-      lval *formals;
-      lval *body;
+      union {
+        lbuiltin_fast fast;
+        struct {
+          lenv *env;
+          lval *formals;
+          lval *body;
+          lcode *code;
+        };
+      };
     };
   };
 } lval;
@@ -88,12 +143,26 @@ typedef struct lval {
  * 定义 lenv 结构体，表示 lisp 环境。
  * par 是父环境，用于实现环境的嵌套。
  * syms 和 vals 分别存储环境中定义的符号及其对应的 lval 值。
+ * syms 中的符号均为驻留后的规范指针，环境不负责释放它们。
+ * cap 是 syms 和 vals 数组的容量，按倍数增长。
+ * 绑定数量较少的环境（如函数调用的局部环境）直接线性扫描 syms；
+ * 绑定数量超过阈值后（如全局环境），额外建立开放寻址哈希索引 index，
+ * index 中保存 syms/vals 的下标，空槽为 -1，mask 为索引大小减一。
+ * ref 为引用计数，lambda 函数的副本借此共享部分应用时绑定的参数，
+ * `lenv_del` 释放引用，计数归零时才真正释放。
+ * global 表示全局环境（由 `lenv_new` 创建），函数调用的帧等其余环境由
+ * `lenv_frame` 创建，global 为 0。
  */
 struct lenv {
   lenv *par;
+  int ref;
+  int global;
   int count;
+  int cap;
   char **syms;
   lval **vals;
+  int *index;
+  int mask;
 };
 
 #endif
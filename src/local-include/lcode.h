@@ -0,0 +1,157 @@
+/*
+ * lcode.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含 lambda 函数体的字节码编译器和解释器的声明。
+ *
+ * lambda 函数在定义时把函数体编译成紧凑的字节码，
+ * 调用时由 `lcode_run` 执行，不再复制和遍历函数体的语法树。
+ * 字节码保持与树遍历求值器完全相同的语义：
+ * 符号在运行时按名查找（动态作用域），S表达式按相同的规则求值、报错。
+ * 唯一的例外是对函数自身形参的引用：调用时形参按顺序绑定在帧的前几个槽位，
+ * 编译时把它们解析为槽位下标，运行时只需核对该槽位的符号，不再逐个比较。
+ * 外层函数的形参在动态作用域下取决于调用者，无法在定义时解析，仍按名查找。
+ * 按名查找的结果如果来自全局环境，就缓存在该符号常量对应的内联缓存中，
+ * 之后只要 `lenv_version` 不变就直接使用，不再沿环境链逐层查找；
+ * 因此函数体中对 `+`、`if` 等内置函数和全局函数的引用几乎没有查找的开销。
+ * 对 `(if 条件 {...} {...})` 形式，只有当 `if` 在运行时绑定到内置函数时
+ * 才直接跳转到编译好的分支，否则按普通的函数调用处理。
+ * 任意个参数的 `(and ...)`、`(or ...)`，以及各个分支都是字面 Q表达式的 `select` 和 `case`
+ * 形式同样如此：绑定到内置函数时按特殊形式执行编译好的代码，
+ * 短路求值，未选中的分支不会被复制或求值，否则按普通的函数调用处理。
+ * 对运行时构造的 Q表达式求值（如 `eval`）仍然使用树遍历求值器。
+ * 定义时优化器（见 `lopt`）改写的表达式编译在守卫之后，
+ * 守卫失败时执行其后按原样编译的代码；性能分析期间守卫总是失败，
+ * 因此分析报告中的调用与函数体的写法一致。
+ */
+#ifndef __LCODE_H__
+#define __LCODE_H__
+
+#include "common.h"
+
+/*
+ * 定义字节码的操作码。
+ * LOP_CONST k: 压入常量 k。
+ * LOP_LOOKUP k: 在当前环境中查找符号常量 k，压入其值或错误；
+ *   k 的内联缓存有效时直接压入缓存的值。
+ * LOP_LOCAL i k: 若当前帧的第 i 个槽位绑定的是符号常量 k，压入其值，
+ *   否则同 LOP_LOOKUP k。
+ * LOP_CALL n: 将栈顶 n 个值作为 S表达式求值（见 `lval_form`），结果压栈；
+ *   参数直接留在栈上传给被调用的函数。
+ * LOP_TAILCALL n: 同 LOP_CALL，但位于尾位置，函数调用交给调用者继续执行。
+ * LOP_IF else then else end tail: 栈顶为 `if` 和条件，
+ *   若 `if` 为内置函数且条件为数值则跳转到对应分支，否则按普通调用处理后跳到 end。
+ * LOP_FORM f else: 栈顶为特殊形式 f（LFORM_*）的函数，若为对应的内置函数则弹出它，
+ *   执行其后编译好的特殊形式，否则跳转到 else 按普通调用处理。
+ * LOP_TEST f i next end: 弹出特殊形式 f 的第 i 个参数的值作为条件，
+ *   值为错误或不是数值时压入错误并跳转到 end；`and` 遇到假、`or` 遇到真时
+ *   压入结果并跳转到 end；`select` 遇到假时跳转到 next。
+ * LOP_MATCH next end: 弹出 `case` 的键，与栈顶的 x 比较，相等时弹出 x，
+ *   不相等时跳转到 next；键为错误时以其替换 x 并跳转到 end。
+ * LOP_ERROR end: 若栈顶为错误，跳转到 end。
+ * LOP_FAIL f: 特殊形式 f 没有选中任何分支，压入错误（`case` 先弹出 x）。
+ * LOP_GUARD else: 若优化器改写所依赖的符号仍绑定到定义时的值，执行其后改写后的代码，
+ *   否则跳转到 else 执行按原样编译的代码。
+ * LOP_JUMP pc: 跳转到 pc。
+ * LOP_RET: 返回栈顶的值。
+ */
+enum {
+  LOP_CONST,
+  LOP_LOOKUP,
+  LOP_LOCAL,
+  LOP_CALL,
+  LOP_TAILCALL,
+  LOP_IF,
+  LOP_FORM,
+  LOP_TEST,
+  LOP_MATCH,
+  LOP_ERROR,
+  LOP_FAIL,
+  LOP_GUARD,
+  LOP_JUMP,
+  LOP_RET
+};
+
+/*
+ * 定义按特殊形式编译的函数。
+ */
+enum { LFORM_AND, LFORM_OR, LFORM_SELECT, LFORM_CASE };
+
+/*
+ * 定义 lcache 结构体，表示一个全局符号查找的内联缓存。
+ * val 为上次在全局环境中找到的值，借用自全局环境，不持有引用；
+ * version 为当时的 `lenv_version`，与当前版本号相等时 val 仍然有效，0 表示空。
+ */
+typedef struct {
+  unsigned long version;
+  lval *val;
+} lcache;
+
+/*
+ * 定义 lguard 结构体，表示优化器改写所依赖的一个符号。
+ * k 为符号常量的下标，val 为该符号在定义时绑定的值，借用自 lcode 的 opt。
+ */
+typedef struct {
+  int k;
+  lval *val;
+} lguard;
+
+/*
+ * 定义 lcode 结构体，表示编译后的函数体。
+ * code 为操作码和操作数组成的指令序列，count 为其长度。
+ * consts 为常量表，其中的 lval 借用自函数体，不持有引用，
+ * 因此 lcode 必须与编译它的函数体一同存活。
+ * cache 与 consts 一一对应，是符号常量的内联缓存。
+ * depth 为执行时需要的最大栈深度。
+ * ref 为引用计数，同一函数的副本共享同一份 lcode。
+ * name 为函数第一次被 `def` 或 `=` 绑定时的名称（驻留后的符号），
+ * 供性能分析器归类，从未绑定过时为 NULL。
+ * memo 为 `memo` 创建的记忆化函数的结果缓存（见 `lmemo`），普通函数为 NULL。
+ * opt 为 Q表达式，持有优化器改写后的表达式和守卫的值，没有改写时为 NULL。
+ * guards 为守卫检查的 nguard 个符号，
+ * checked 为上次检查守卫时的 `lenv_version`，valid 为当时的结果。
+ */
+typedef struct lcode {
+  int ref;
+  int count;
+  int *code;
+  int nconst;
+  lval **consts;
+  lcache *cache;
+  int depth;
+  char *name;
+  lmemo *memo;
+  lval *opt;
+  int nguard;
+  lguard *guards;
+  unsigned long checked;
+  int valid;
+} lcode;
+
+/*
+ * 将形参列表为 `formals` 的 lambda 函数体 `body`（Q表达式）编译为字节码。
+ * 参数 `e`: 定义函数的环境，优化器据此改写函数体（见 `lopt_env`），
+ *   为 NULL 时按原样编译。
+ * 注意: `lcode_compile` 不对 `formals` 和 `body` 拥有所有权，
+ * 但返回的 lcode 借用 `body` 中的值。
+ * "调用者"负责使用 `lcode_del` 释放返回的 lcode。
+ */
+lcode *lcode_compile(lenv *e, lval *formals, lval *body);
+/*
+ * 在环境 `e` 中执行字节码 `c`。
+ * 操作数栈就是求值器的值栈（见 `lstack`），从调用时的栈顶开始使用。
+ * 返回: 函数体的值，`*f` 为 NULL。如果函数体以尾调用结束，
+ * 则将被调用的函数存入 `*f` 并返回 NULL，其参数留在值栈上，
+ * 从调用时的栈顶开始依次排列，由调用者完成调用。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval 和 `*f`。
+ */
+lval *lcode_run(lenv *e, lcode *c, lval **f);
+/*
+ * 共享 lcode `c`，增加其引用计数并返回 `c`。
+ */
+lcode *lcode_copy(lcode *c);
+/*
+ * 释放 lcode `c` 的一个引用，计数归零时释放其内存。
+ */
+void lcode_del(lcode *c);
+
+#endif
@@ -9,12 +9,35 @@
 #include "common.h"
 #include <mpc.h>
 
+/*
+ * 全局环境的版本号。全局环境中的绑定发生任何变化时加一，
+ * 其他环境绑定一个在当前版本中被缓存过全局查找结果的符号（见 `lsym_set_cached`，
+ * 该绑定会遮蔽缓存的全局绑定）时同样加一；绑定其他符号的帧不改变版本号。
+ * 因此只要版本号不变，上次在全局环境中找到的值就仍然是查找的结果，
+ * 字节码借此缓存全局符号的查找（见 `lcode`），缓存时须调用 `lsym_set_cached`。
+ * 这依赖于动态作用域下，存活的帧都在当前的环境链上：
+ * 帧在绑定参数之后、其中的代码开始执行之前就已经加入环境链。
+ */
+extern unsigned long lenv_version;
+
+/*
+ * 创建一个新的空环境，用作函数调用的帧或 `let` 的环境，而非全局环境。
+ * 帧从缓存的空闲环境中重用（见 `lenv_del`）。
+ * "调用方"负责使用 `lenv_del` 释放返回的环境。
+ */
+lenv *lenv_frame(void);
 /*
  * 从环境 `e` 或其父环境中获取符号 `k` 的值。
  * 如果找不到符号 `k`，返回 LVAL_ERR。
  * "调用方"负责使用 `lval_del` 释放返回的值。
  */
 lval *lenv_get(lenv *e, lval *k);
+/*
+ * 同 `lenv_get`，但如果绑定位于全局环境中，将其值存入 `*global`
+ * （不增加引用计数，只在 `lenv_version` 不变时有效），否则存入 NULL。
+ * "调用方"负责使用 `lval_del` 释放返回的值。
+ */
+lval *lenv_lookup(lenv *e, lval *k, lval **global);
 /*
  * 将值 `v` 绑定到环境 `e` 中的符号 `k`。
  * 注意：`lenv_put` 不对 `k` 和 `v` 拥有所有权，不负责释放它们。
@@ -26,14 +49,28 @@ void lenv_put(lenv *e, lval *k, lval *v);
  */
 void lenv_def(lenv *e, lval *k, lval *v);
 /*
- * 返回环境 `e` 的一个副本。
+ * 确保环境 `e` 至少能容纳 `n` 个绑定而无需再扩容。
+ * 函数调用的帧预留全部形参的容量，绑定参数时只需分配一次。
+ */
+void lenv_reserve(lenv *e, int n);
+/*
+ * 共享环境 `e`，增加其引用计数并返回 `e`。
+ * 共享的环境视为不可变。
  * 调用方负责使用 `lenv_del` 释放返回的环境。
- * 注意：`lenv_copy` 不会释放原始环境 `e`。
  */
-lenv *lenv_copy(lenv *e);
+lenv *lenv_share(lenv *e);
+/*
+ * 将环境 `from` 中 `e` 尚未绑定的符号复制到 `e` 中，
+ * 并让 `e` 继承 `from` 的父环境。
+ * 尾调用时被调函数的环境借此取代调用者的环境，使环境链的深度保持不变。
+ * 注意：`lenv_merge` 不会释放 `from`。
+ */
+void lenv_merge(lenv *e, lenv *from);
 /*
- * 向环境 `e` 添加一个内置函数，提供函数名 `name` 和函数指针 `func`。
+ * 向环境 `e` 添加一个内置函数，提供函数名 `name` 和函数指针 `func`，
+ * 以及其快速路径 `fast`（见 `lbuiltin_fast`），没有时为 NULL。
  */
-void lenv_add_builtin(lenv *e, char *name, lbuiltin func);
+void lenv_add_builtin(lenv *e, char *name, lbuiltin func,
+                      lbuiltin_fast fast);
 
 #endif
@@ -0,0 +1,54 @@
+/*
+ * lgc.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含可选的分代回收器的函数声明，它是衡量循环回收代价的工具。
+ *
+ * 默认情况下 lval 仅依靠引用计数管理，本模块的函数退化为直接调用 lmem。
+ * 通过 `lgc_enable` 启用回收器后，每个 lval 前都带有一个回收器头部，
+ * 容器类型的 lval（S表达式、Q表达式和 lambda 函数，
+ * lambda 函数通过其环境 env 追踪环境中的绑定）会被登记到分代链表中：
+ * - 新登记的对象进入第 0 代（nursery），
+ * - 在一次回收中存活的对象晋升到下一代，
+ * - 每 10 次第 0 代回收进行一次第 1 代回收，每 10 次第 1 代回收进行一次全部回收。
+ *
+ * 回收使用试删除（trial deletion）算法：对一组对象，
+ * 用引用计数减去组内对象之间的引用，剩余计数大于零的对象
+ * 一定被组外（解释器的环境、求值器的值栈和 C 栈）引用，以它们为根标记可达对象，
+ * 其余对象即为只能通过循环互相引用的垃圾。
+ * 因此回收可以在任何一次 lval 分配时安全地进行，无需扫描 C 栈。
+ *
+ * 在当前的所有权模型下 lval 之间不会形成循环：Q表达式写时复制，
+ * 部分应用的环境创建后不再修改，所以回收器实际上不会释放任何对象。
+ * 它用于在同一负载上比较登记和扫描带来的吞吐量开销与暂停时间的直方图，
+ * 并检验上述不变式（`lgc_report` 报告的释放数应为 0）。
+ * 回收不是增量的，暂停时间与被扫描的代中的对象数成正比，全部回收时与堆的大小成正比。
+ */
+#ifndef __LGC_H__
+#define __LGC_H__
+
+#include "common.h"
+
+/*
+ * 为一个 lval 分配内存，启用回收器时同时分配回收器头部。
+ * 返回的 lval 尚未登记，字段未初始化。
+ * 启用回收器时可能在分配前触发一次回收。
+ * "调用者"负责使用 `lgc_free` 释放返回的 lval。
+ */
+lval *lgc_alloc(void);
+/*
+ * 释放由 `lgc_alloc` 分配的 lval `v`，如果 `v` 已登记则先注销。
+ * 注意: 只释放 `v` 本身，`v` 持有的子元素应由调用者先行释放。
+ */
+void lgc_free(lval *v);
+/*
+ * 将已初始化完毕的容器 lval `v` 登记到第 0 代。
+ * 未启用回收器或 `v` 不是容器类型时不做任何操作。
+ */
+void lgc_track(lval *v);
+/*
+ * 回收第 `gen` 代及更年轻的代，`gen` 为 2 时扫描全部登记的对象。
+ * 返回: 本次回收释放的对象数量。
+ */
+int lgc_collect(int gen);
+
+#endif
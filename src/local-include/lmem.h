@@ -0,0 +1,43 @@
+/*
+ * lmem.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含 lval 结构体和 cell 数组所用的分级 slab 分配器的函数声明。
+ *
+ * 小于等于 LMEM_SMALL_MAX 字节的请求按尺寸类从 slab 中分配，
+ * 每个 slab 维护自己的空闲链表；更大的请求直接交给 malloc。
+ * 与 malloc/free 不同，释放和重新分配时调用方需要提供块的原始大小，
+ * 这样分配器无需在每个块前保存头部信息。
+ */
+#ifndef __LMEM_H__
+#define __LMEM_H__
+
+#include <stddef.h>
+
+#define LMEM_SMALL_MAX 256
+
+/*
+ * 分配 `size` 字节的内存。
+ * 返回: 指向新分配内存的指针，`size` 为 0 时返回 NULL。
+ * "调用方"负责使用 `lmem_free` 并传入相同的 `size` 释放返回的内存。
+ */
+void *lmem_alloc(size_t size);
+/*
+ * 释放由 `lmem_alloc` 或 `lmem_realloc` 分配的内存 `p`。
+ * 参数 `size`: 分配 `p` 时请求的字节数。
+ * `p` 为 NULL 时不做任何操作。
+ */
+void lmem_free(void *p, size_t size);
+/*
+ * 将 `p` 指向的内存从 `old_size` 字节调整为 `new_size` 字节。
+ * 语义同 realloc：保留前 min(old_size, new_size) 字节的内容，
+ * `p` 为 NULL 时等价于 `lmem_alloc`，`new_size` 为 0 时等价于 `lmem_free`。
+ * 返回: 调整后的内存指针，原指针 `p` 不应再被使用。
+ */
+void *lmem_realloc(void *p, size_t old_size, size_t new_size);
+/*
+ * 返回: 程序开始以来 `lmem_alloc` 成功分配内存的次数，
+ * 包括直接交给 malloc 的大块，用于基准测试统计分配次数。
+ */
+size_t lmem_allocs(void);
+
+#endif
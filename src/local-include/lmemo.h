@@ -0,0 +1,50 @@
+/*
+ * lmemo.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含记忆化函数的结果缓存的类型和函数声明。
+ *
+ * 缓存以参数列表为键、调用结果为值，按 `lval_hash` 分桶，用 `lval_eq` 比较，
+ * 键和值都只共享引用，不复制。缓存的条目数有上限，
+ * 超出时淘汰最久未被命中的条目（LRU）。
+ * 缓存挂在 lambda 函数的字节码上（见 `lcode`），因此同一函数的所有副本共享同一个缓存，
+ * 函数最后一个副本被释放时缓存随之释放。
+ */
+#ifndef __LMEMO_H__
+#define __LMEMO_H__
+
+#include "common.h"
+
+/* `memo` 未指定上限时缓存的条目数。 */
+#define LMEMO_CAP 4096
+
+/*
+ * 创建一个最多缓存 `cap` 个条目的空缓存。
+ * "调用者"负责使用 `lmemo_del` 释放返回的缓存。
+ */
+lmemo *lmemo_new(int cap);
+/*
+ * 释放缓存 `m` 及其持有的所有键和值的引用。
+ */
+void lmemo_del(lmemo *m);
+/*
+ * 查找参数列表 `key` 对应的结果，并记录一次命中或未命中。
+ * 返回: 命中时返回结果的一个共享引用，否则返回 NULL。
+ * 原始 lval `key` 的所有权和管理责任仍由调用者持有。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lmemo_get(lmemo *m, lval *key);
+/*
+ * 记录参数列表 `key` 的结果 `val`，已有该键时替换其结果。
+ * 条目数超过上限时淘汰最久未被命中的条目。
+ * 缓存共享 `key` 和 `val` 的引用，原始 lval 的所有权仍由调用者持有，
+ * 此后两者都不应再被修改。
+ */
+void lmemo_put(lmemo *m, lval *key, lval *val);
+/*
+ * 返回缓存的统计信息组成的 Q表达式，每个元素为 `{名称 数值}`：
+ * hits、misses、size（当前条目数）、cap（上限）和 evictions（淘汰次数）。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lmemo_list(lmemo *m);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * lopt.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含定义时优化器的类型和函数声明。
+ *
+ * 定义 lambda 函数时，字节码编译器对函数体中的每个 S表达式询问优化器，
+ * 优化器按全局环境中的绑定（而非定义处的帧）给出一个改写后的表达式：
+ * - 参数都是常量的 `+`、`==`、`not` 等内置函数调用（即有快速路径的内置函数）
+ *   直接折叠为结果，结果为错误（如 `(/ 1 0)`）时保持原样；
+ *   绑定到数值的全局符号（如 `true`）也视为常量。
+ * - 条件为常量的 `(if 条件 {...} {...})` 改写为被选中的分支。
+ * - 对 `not` 这类只调用内置函数的简单包装函数的调用，
+ *   改写为以实参替换形参后的函数体。
+ *   只内联每个形参按顺序恰好出现一次、且在最后一个形参求值之后才调用函数的包装函数，
+ *   因此实参的求值顺序、副作用和报错都与调用时相同。
+ *   内联后包装函数的帧不再存在，因此包装函数只能调用已知不会在所在帧中
+ *   求值代码或绑定名字的内置函数（有快速路径的内置函数和 `head`、`list` 等），
+ *   调用了 `eval`、`profile`、`map` 等其他内置函数的包装函数（如 `fst`）不做内联。
+ * 改写依赖的每个符号（被调用的内置函数、被内联的函数、被折叠的全局常量）
+ * 及其在定义时的值都记录下来，作为字节码的守卫（见 `lcode`）：
+ * 执行到改写处时只有这些符号仍然绑定到定义时的值才执行改写后的代码，
+ * 否则执行按原样编译的代码，因此之后重新定义 `+` 或在调用者中遮蔽它都不会出错。
+ * 函数的形参遮蔽的符号不做改写，函数体中的 Q表达式（`if` 的分支
+ * 和 `select`、`case` 的各个分支除外）视为数据，不做改写。
+ * 距全局环境超过 `LOPT_MAX_DEPTH` 层帧创建的 lambda 函数不做优化：
+ * 它们通常是随每次调用重新创建的闭包，改写的代价往往超过收益。
+ */
+#ifndef __LOPT_H__
+#define __LOPT_H__
+
+#include "common.h"
+
+/* 定义处距全局环境最多多少层帧时做优化。 */
+#define LOPT_MAX_DEPTH 8
+
+/*
+ * 优化器是否启用，默认启用，见 `lopt_disable`。
+ */
+extern int lopt_on;
+
+/*
+ * 定义 lopt 结构体，表示一次函数体编译中的优化器状态。
+ * e 为全局环境，formals 为函数的形参列表，均为借用。
+ * keep 为 Q表达式，持有优化器给出的全部改写后的表达式。
+ * assume 为 Q表达式，其中每一项为 `{符号 值}`，记录改写依赖的符号及其定义时的值。
+ */
+typedef struct {
+  lenv *e;
+  lval *formals;
+  lval *keep;
+  lval *assume;
+} lopt;
+
+/*
+ * 在环境 `e` 中定义的函数由优化器改写时，返回 `e` 所在的全局环境，
+ * 否则（优化器关闭、`e` 为 NULL 或距全局环境太远）返回 NULL。
+ */
+lenv *lopt_env(lenv *e);
+/*
+ * 初始化优化器状态 `o`，用于定义形参为 `formals` 的函数，`e` 为全局环境。
+ * "调用者"负责使用 `lopt_quit` 释放其中的 `keep` 和 `assume`，
+ * 或者接管它们的所有权。
+ */
+void lopt_init(lopt *o, lenv *e, lval *formals);
+/*
+ * 释放优化器状态 `o` 持有的 `keep` 和 `assume`。
+ */
+void lopt_quit(lopt *o);
+/*
+ * 改写由 `cells` 中的 `n` 个元素组成的 S表达式。
+ * 返回: 改写后的表达式，其顶层不能再被改写；不做改写时返回 NULL。
+ * 返回的 lval 由 `o->keep` 持有，与之一同存活，调用者不应释放或修改它。
+ */
+lval *lopt_form(lopt *o, lval **cells, int n);
+/*
+ * 检查在环境 `e` 中定义的、形参为 `formals` 的函数体 `body`
+ * （`lopt_env` 返回 NULL 时不做检查）：对参数个数不符合内置函数要求的调用向 stderr 打印警告；
+ * 转储模式下（见 `lopt_dump`）向 stdout 打印优化器改写前后的函数体。
+ * 注意: `lopt_check` 不对 `formals` 和 `body` 拥有所有权。
+ */
+void lopt_check(lenv *e, lval *formals, lval *body);
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * lprof.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含性能分析器的函数声明。
+ *
+ * 分析器在求值器中维护一个影子调用栈：每次调用内置函数或 lambda 函数时
+ * 压入一帧，返回时弹出，借此统计每个函数的调用次数、lval 分配次数，
+ * 以及包含子调用的总时间（total）和不含子调用的自身时间（self）。
+ * 函数按绑定的名称归类：内置函数使用 `lenv_add_builtins` 中的名称，
+ * lambda 函数使用第一次被 `def` 或 `=` 绑定时的名称，从未绑定过的记为 <lambda>。
+ * `if` 和 `eval` 在尾位置转移控制，不单独计数，其中的时间计入调用者。
+ *
+ * 分析期间另有一个 SIGPROF 定时器按 CPU 时间每毫秒触发一次，
+ * 信号处理函数只记录一次待处理的采样，下一次进入或离开函数时
+ * 再把当时的影子栈记入采样，因此不需要在信号处理函数中分配内存。
+ * 采样汇总为 flamegraph 等工具使用的折叠栈格式（每行 `a;b;c 次数`）。
+ * 采样模式下不读取时钟，只维护影子栈，开销更低。
+ */
+#ifndef __LPROF_H__
+#define __LPROF_H__
+
+#include "common.h"
+
+/*
+ * 分析器是否正在运行。
+ * 求值器在每次调用前后检查该变量，未运行时不调用其他任何分析器函数。
+ */
+extern int lprof_on;
+
+/*
+ * 为函数 `f` 命名为 `name`（驻留后的符号），已有名称时不做任何操作。
+ * 内置函数的名称按函数指针记录，lambda 函数的名称记录在其字节码中，
+ * 因此同一函数的所有副本共享同一个名称。
+ */
+void lprof_name(lval *f, char *name);
+/*
+ * 进入函数 `f`，在影子栈中压入一帧。
+ */
+void lprof_enter(lval *f);
+/*
+ * 离开影子栈顶的函数，将其时间计入统计。
+ */
+void lprof_leave(void);
+/*
+ * 记录一次 lval 分配，计入影子栈顶的函数。
+ */
+void lprof_alloc(void);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * lread.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含手写读取器（reader）的类型和函数声明。
+ *
+ * 读取器一次扫描源代码缓冲区，直接构造 lval，不生成中间语法树：
+ * 符号直接从缓冲区中驻留，数值就地转换，只有字符串需要复制并反转义。
+ * 接受的语法与 `parser_init` 中的 mpc 语法完全相同：
+ * - 顶层只能是 S表达式和 `;` 注释，
+ * - 表达式为数值、符号、字符串、S表达式或 Q表达式，
+ * - 数值优先于符号匹配，字符串中的转义与 `mpcf_unescape` 一致。
+ */
+#ifndef __LREAD_H__
+#define __LREAD_H__
+
+#include <stddef.h>
+
+#include "common.h"
+
+/*
+ * 定义 lreader 结构体，表示对一段源代码的读取状态。
+ * name 为源代码的名称，用于错误信息。
+ * buf 和 end 为缓冲区的起止位置，p 为当前读取位置。
+ * err 为读取过程中遇到的语法错误。
+ * 由 `lread_open` 打开的文件，data 和 size 为文件的映射（或读入的副本），
+ * mapped 表示 data 是否为内存映射，released 为映射中已读取并归还的字节数。
+ */
+typedef struct lreader {
+  const char *name;
+  const char *buf;
+  const char *p;
+  const char *end;
+  lval *err;
+  void *data;
+  size_t size;
+  int mapped;
+  size_t released;
+} lreader;
+
+/*
+ * 初始化读取器 `r`，从 `s` 开始的 `len` 个字节中读取。
+ * 注意: `r` 不对 `name` 和 `s` 拥有所有权，读取期间它们必须保持有效。
+ */
+void lread_init(lreader *r, const char *name, const char *s, size_t len);
+/*
+ * 打开文件 `filename` 并初始化读取器 `r` 从中读取。
+ * 普通文件被只读映射到内存，按需换入，不会整体读入，
+ * 已经读过的部分每隔一段就归还给系统，使驻留内存不随文件大小增长；
+ * 无法映射的文件（如管道）则读入一份副本。
+ * 返回: 成功时返回 1，无法打开文件时返回 0。
+ * 注意: `r` 不对 `filename` 拥有所有权，读取期间它必须保持有效。
+ * "调用者"负责使用 `lread_close` 关闭读取器。
+ */
+int lread_open(lreader *r, const char *filename);
+/*
+ * 关闭由 `lread_open` 打开的读取器 `r`，解除文件映射。
+ * 已读取的 lval 不引用映射中的内容，关闭后仍然有效。
+ */
+void lread_close(lreader *r);
+/*
+ * 读取下一个顶层表达式，跳过之间的空白和注释。
+ * 返回: 读取到的 S表达式；到达末尾时返回 NULL；
+ * 遇到语法错误时返回 LVAL_ERR，此后再读取只会返回 NULL。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lread_next(lreader *r);
+/*
+ * 读取 `s` 开始的 `len` 个字节中的全部顶层表达式。
+ * 返回: 由全部顶层表达式组成的 S表达式，任何一处语法错误都返回 LVAL_ERR。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lread_all(const char *name, const char *s, size_t len);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+ * lstack.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含求值器的值栈的类型和函数声明。
+ *
+ * 求值 S表达式时，其中的函数和参数依次求值并压入这个连续的栈，
+ * 调用时内置函数的快速路径（见 `lbuiltin_fast`）和 lambda 函数
+ * 直接从栈上读取参数，不再为每次调用构造参数列表。
+ * 字节码解释器的操作数栈也是这个栈。
+ * 栈的数组在增长时可能被移动，因此在可能求值的代码中应按下标访问，
+ * 不应持有指向栈中元素的指针。
+ */
+#ifndef __LSTACK_H__
+#define __LSTACK_H__
+
+#include "common.h"
+
+/*
+ * 定义 lstack 结构体。
+ * vals 为栈的数组，共 cap 个槽位，sp 为栈顶的下标（即栈中值的个数）。
+ * 栈中每个值持有一个引用。
+ */
+struct lstack {
+  lval **vals;
+  int sp;
+  int cap;
+};
+
+extern struct lstack lstack;
+
+/*
+ * 确保栈顶之上至少还有 `n` 个空闲槽位，此后压入 `n` 个值之前都无需再检查。
+ */
+void lstack_reserve(int n);
+/*
+ * 将值 `x` 压入栈顶，栈接管 `x` 的引用。
+ */
+void lstack_push(lval *x);
+/*
+ * 弹出栈顶的 `n` 个值，释放它们的引用。
+ */
+void lstack_drop(int n);
+/*
+ * 弹出栈顶的 `n` 个值，按原顺序组成一个 S表达式返回。
+ * 供只接受参数列表的内置函数使用。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lstack_list(int n);
+
+#endif
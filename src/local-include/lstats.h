@@ -0,0 +1,52 @@
+/*
+ * lstats.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含内存统计计数器的类型和函数声明。
+ *
+ * 计数器始终开启，每次计数只是一次整数加法：
+ * - 按类型统计创建的 lval 数量、当前存活的数量（census）以及存活总数的最高值，
+ *   S表达式和 Q表达式可以原地互相转换，因此合并为同一类（expr），
+ * - 共享返回、不需要分配的永久 lval（小整数和符号）的次数，
+ * - `lval_copy` 共享引用的次数，以及 `lval_mut` 真正复制的次数和复制的字节数，
+ * - `lenv_new` 和 `lenv_share` 的次数、存活的环境数及其最高值，
+ * - cell 数组的分配（包括增长时的重新分配）次数和字节数。
+ */
+#ifndef __LSTATS_H__
+#define __LSTATS_H__
+
+#include "common.h"
+
+#define LSTATS_KINDS (LVAL_VEC + 1)
+#define LSTATS_KIND(t) ((t) == LVAL_QEXPR ? LVAL_SEXPR : (t))
+
+/*
+ * 定义 lstats 结构体，保存全部计数器。
+ * made 和 live 以 `LSTATS_KIND` 得到的类型为下标。
+ */
+struct lstats {
+  long made[LSTATS_KINDS];
+  long live[LSTATS_KINDS];
+  long live_total;
+  long peak;
+  long shared;
+  long copies;
+  long clones;
+  long clone_bytes;
+  long envs;
+  long env_shares;
+  long env_live;
+  long env_peak;
+  long cells;
+  long cell_bytes;
+};
+
+extern struct lstats lstats;
+
+/*
+ * 返回由全部计数器组成的 Q表达式，每个元素为 `{名称 数值}`，
+ * 如 `{made-num 12}`、`{live-expr 3}`、`{peak 120}`。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lstats_list(void);
+
+#endif
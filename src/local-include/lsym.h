@@ -0,0 +1,53 @@
+/*
+ * lsym.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含符号驻留表（intern table）的函数声明。
+ *
+ * 每个不同的符号名在驻留表中只保存一份，`lsym_intern` 返回其规范指针。
+ * 因此两个驻留后的符号相等当且仅当它们的指针相等，
+ * 比较符号时不再需要 strcmp，复制符号时也不再需要复制字符串。
+ * 规范指针在 `lsym_quit` 之前一直有效，调用方不应修改或释放它。
+ */
+#ifndef __LSYM_H__
+#define __LSYM_H__
+
+#include <stddef.h>
+
+#include "common.h"
+
+/*
+ * 返回符号名 `s` 的规范指针。
+ * 如果 `s` 尚未驻留，则复制一份加入驻留表。
+ * 注意: `lsym_intern` 不对 `s` 拥有所有权。
+ */
+char *lsym_intern(const char *s);
+/*
+ * 同 `lsym_intern`，但符号名为 `s` 开头的 `n` 个字节，`s` 无需以 '\0' 结尾。
+ * 用于直接从源代码缓冲区中驻留符号，无需先复制出符号名。
+ */
+char *lsym_intern_n(const char *s, size_t n);
+/*
+ * 返回驻留符号 `sym` 的哈希值。
+ * 参数 `sym`: 必须是 `lsym_intern` 返回的规范指针。
+ * 哈希值在驻留时计算一次，此后直接读取。
+ */
+unsigned lsym_hash(const char *sym);
+/*
+ * 返回驻留符号 `sym` 唯一的 LVAL_SYM 类型的 lval。
+ * 参数 `sym`: 必须是 `lsym_intern` 返回的规范指针。
+ * 该 lval 与符号一同保存在驻留表中，是永久的（见 LVAL_IMMORTAL），
+ * 返回时不增加引用计数，调用者需要持有时应使用 `lval_copy`。
+ */
+lval *lsym_lval(const char *sym);
+/*
+ * 记录驻留符号 `sym` 在全局环境中的绑定在 `lenv_version` 为 `version` 时被缓存。
+ * 其他环境在同一版本中绑定这样的符号时需要使缓存失效（见 `lenv_version`）。
+ */
+void lsym_set_cached(const char *sym, unsigned long version);
+/*
+ * 返回: 驻留符号 `sym` 在全局环境中的绑定在版本 `version` 被缓存过时返回 1，
+ * 否则返回 0。只记录版本号的低 32 位，回绕时可能误报，但不会漏报。
+ */
+int lsym_cached(const char *sym, unsigned long version);
+
+#endif
@@ -21,6 +21,7 @@
  *
  * LASSERT_NUM: 检查参数数量
  * LASSERT_TYPE: 检查参数类型
+ * LASSERT_RANGE: 检查数值参数是否在 0 到 max 之间
  * LASSERT_NOT_EMPTY: 检查 S表达式或 Q表达式是否为空
  */
 #define LASSERT(args, cond, fmt, ...)                                          \
@@ -45,14 +46,48 @@
           func, index, ltype_name(args->cell[index]->type),                    \
           ltype_name(expect))
 
+#define LASSERT_RANGE(func, args, index, n, max)                               \
+  LASSERT(args, (n) >= 0 && (n) <= (max),                                      \
+          "Function '%s' passed out of range value for argument %i. "          \
+          "Got %li, Expected 0 to %i.",                                        \
+          func, index, (long)(n), (int)(max))
+
 #define LASSERT_NOT_EMPTY(func, args, index)                                   \
   LASSERT(args, args->cell[index]->count != 0,                                 \
           "Function '%s' passed {} for argument %i.", func, index);
 
+/*
+ * LCHECK 宏 - 同 LASSERT，用于内置函数的快速路径（见 `lbuiltin_fast`）。
+ * 参数由调用者释放，因此断言失败时只返回错误，不释放任何值。
+ * `args` 为参数数组，`n` 为参数个数。
+ *
+ * LCHECK_NUM: 检查参数数量
+ * LCHECK_TYPE: 检查参数类型
+ */
+#define LCHECK(cond, fmt, ...)                                                 \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      return lval_err(fmt, ##__VA_ARGS__);                                     \
+    }                                                                          \
+  } while (0)
+
+#define LCHECK_NUM(func, n, num)                                               \
+  LCHECK(n == num,                                                             \
+         "Function '%s' passed incorrect number of arguments. "                \
+         "Got %i, Expected %i.",                                               \
+         func, n, num)
+
+#define LCHECK_TYPE(func, args, index, expect)                                 \
+  LCHECK(args[index]->type == expect,                                          \
+         "Function '%s' passed incorrect type for argument %i. "               \
+         "Got %s, Expected %s.",                                               \
+         func, index, ltype_name(args[index]->type), ltype_name(expect))
+
 /*
  * 创建一个新的数值类型的 lval。
  * 参数 `x`: 需要封装的数值。
  * 返回: 指向新创建的 lval 的指针。
+ * 小整数返回共享的永久 lval，不分配内存，修改前必须先调用 `lval_mut`。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *lval_num(long x);
@@ -67,10 +102,15 @@ lval *lval_err(char *fmt, ...);
 /*
  * 创建一个新的符号类型的 lval。
  * 参数 `s`: 符号字符串。
- * 返回: 指向新创建的 lval 的指针。
+ * 返回: 该符号共享的永久 lval（见 `lsym_lval`），不分配内存。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *lval_sym(char *s);
+/*
+ * 同 `lval_sym`，但符号为 `s` 开头的 `n` 个字节，`s` 无需以 '\0' 结尾。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lval_sym_n(const char *s, size_t n);
 /*
  * 创建一个新的字符串类型的 lval。
  * 参数 `s`: 字符串。
@@ -78,6 +118,11 @@ lval *lval_sym(char *s);
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *lval_str(char *s);
+/*
+ * 同 `lval_str`，但字符串为 `s` 开头的 `n` 个字节，`s` 无需以 '\0' 结尾。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lval_str_n(const char *s, size_t n);
 /*
  * 创建一个新的空 S表达式类型的 lval。
  * 返回: 指向新创建的 lval 的指针。
@@ -97,32 +142,51 @@ lval *lval_qexpr(void);
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *lval_fun(lbuiltin func);
+/*
+ * 创建一个新的数值向量类型的 lval，共 `len` 个元素，元素未初始化。
+ * 返回: 指向新创建的 lval 的指针。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lval_vec(int len);
 /*
  * 创建一个新的 lambda 函数类型的 lval。
+ * 参数 `e`: 定义函数的环境，优化器据此改写编译后的函数体（见 `lopt`）。
  * 参数 `formals`: 形式参数列表，LVAL_QEXPR 类型。
  * 参数 `body`: 函数体，LVAL_QEXPR 类型。
  * 返回: 指向新创建的 lval 的指针。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
-lval *lval_lambda(lval *formals, lval *body);
+lval *lval_lambda(lenv *e, lval *formals, lval *body);
 /*
  * 将两个 LVAL_SEXPR | LVAL_QEXPR lval 连接成一个。
  * 参数 `x`, `y`: 需要连接的两个 lval。
  * 返回: 指向连接后的 lval 的指针。
- * 原始 lval 'y' 在连接后被释放，调用者不应再使用它。
+ * 原始 lval `x` 和 `y` 在连接后被释放，调用者不应再使用它们。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
- * 原始 lval `x` 的所有权和管理责任仍由调用者持有。
- * 注意: 返回值与 `x` 指向同一对象。
+ * 注意: `x` 独占时返回值与 `x` 指向同一对象，否则返回 `x` 的副本。
  */
 lval *lval_join(lval *x, lval *y);
 /*
- * 返回 lval 的一个副本。
+ * 返回 lval 的一个共享引用，时间复杂度为 O(1)。
  * 参数 `v`: 需要复制的 lval。
- * 返回: 指向新复制的 lval 的指针。
+ * 返回: 与 `v` 指向同一对象的指针，引用计数加一。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  * 原始 lval `v` 的所有权和管理责任仍由调用者持有。
+ * 注意: 返回值是共享的，修改前必须先调用 `lval_mut`。
  */
 lval *lval_copy(lval *v);
+/*
+ * 返回 lval 的一个可修改（独占）版本，即写时复制。
+ * 参数 `v`: 需要修改的 lval。
+ * 返回:
+ *  - 如果 `v` 未被共享，直接返回 `v`；
+ *    `v` 是表达式的视图时，先使其独占自己的元素（见 `lval_slice`）。
+ *  - 否则返回 `v` 的浅副本（子元素、形参和函数体仍然共享），
+ *    并释放调用者对 `v` 的引用。
+ * 原始 lval `v` 的引用由本函数接管，调用者应改用返回值。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lval_mut(lval *v);
 /*
  * 比较两个 lval 是否相等。
  * 参数 `x`, `y`: 需要比较的两个 lval。
@@ -130,6 +194,16 @@ lval *lval_copy(lval *v);
  * 原始 lval `x`, `y` 的所有权和管理责任仍由调用者持有。
  */
 int lval_eq(lval *x, lval *y);
+/*
+ * 计算 lval 的结构哈希值，与 `lval_eq` 一致：相等的两个 lval 哈希值一定相同。
+ * 表达式的哈希值缓存在其 hash 中，共享的表达式不会被修改，只需计算一次；
+ * `lval_eq` 比较两个都已缓存哈希值的表达式时，哈希值不同即可直接判定不相等。
+ * 函数只按内置函数指针或形参和函数体计算，与 `lval_eq` 相同，不考虑其环境。
+ * 参数 `v`: 需要计算的 lval。
+ * 返回: 哈希值。
+ * 原始 lval `v` 的所有权和管理责任仍由调用者持有。
+ */
+unsigned long lval_hash(lval *v);
 /*
  * 从抽象语法树节点中读取一个数值，并封装成 LVAL_NUM 类型的 lval。
  * 参数 `t`: 指向 mpc_ast_t 结构的指针，代表抽象语法树节点。
@@ -152,8 +226,7 @@ lval *lval_read_str(mpc_ast_t *t);
  * 参数 `x`: 指向要被添加的 lval 的指针。
  * 返回: 指向更新后的 lval 的指针。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
- * 原始 lval `v` 的所有权和管理责任仍由调用者持有。
- * 注意: 返回值与 `v` 指向同一对象。
+ * 原始 lval `v` 的引用由本函数接管（见 `lval_mut`），调用者应改用返回值。
  */
 lval *lval_add(lval *v, lval *x);
 /*
@@ -162,10 +235,31 @@ lval *lval_add(lval *v, lval *x);
  * 参数 x: 指向要被插入的 lval 的指针。
  * 返回: 指向更新后的 lval 的指针。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
- * 原始 lval `v` 的所有权和管理责任仍由调用者持有。
- * 注意: 返回值与 `v` 指向同一对象。
+ * 原始 lval `v` 的引用由本函数接管（见 `lval_mut`），调用者应改用返回值。
  */
 lval *lval_add_front(lval *v, lval *x);
+/*
+ * 截取表达式 `v` 中从索引 `i` 开始的 `n` 个元素。
+ * 如果 `v` 被共享，返回与 `v` 共享元素的视图，不复制元素，时间为 O(1)；
+ * 否则就地截取，释放截取范围之外的元素。
+ * 此后在视图的两端添加元素时，只要两端之外的槽位尚未被其他视图占用，
+ * 就直接写入共享的数组，同样不复制元素。
+ * 参数 `i`, `n`: 必须满足 0 <= i, 0 <= n, i + n <= v->count。
+ * 原始 lval `v` 的引用由本函数接管，调用者应改用返回值。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *lval_slice(lval *v, int i, int n);
+/*
+ * 确保 LVAL_SEXPR | LVAL_QEXPR 类型的 lval 在末尾至少能容纳 `n` 个元素，
+ * 此后添加元素直到 `n` 个之前都不再重新分配数组。
+ * 注意: `v` 必须是独占的（见 `lval_mut`）。
+ */
+void lval_reserve(lval *v, int n);
+/*
+ * 释放 LVAL_SEXPR | LVAL_QEXPR 类型的 lval 的全部元素及其数组，使其成为空表达式。
+ * 注意: `v` 必须是独占的（见 `lval_mut`），`v` 本身不会被释放。
+ */
+void lval_clear(lval *v);
 
 /*
  * 获取列表的第一个元素。
@@ -203,6 +297,16 @@ lval *builtin_list(lenv *e, lval *a);
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *builtin_eval(lenv *e, lval *a);
+/*
+ * 取出 eval 应当求值的表达式，但不对其求值。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含一个 Q表达式的 lval。
+ * 返回: 类型已改为 S表达式的待求值表达式，参数不合法时返回错误。
+ * 求值器借此在尾位置上直接继续求值，而不是递归调用 `lval_eval`。
+ * 原始 lval 'a' 被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_eval_expr(lenv *e, lval *a);
 /*
  * 将多个 Q表达式合并成一个。
  * 参数 `e`: 当前 Lisp 环境。
@@ -239,6 +343,69 @@ lval *builtin_len(lenv *e, lval *a);
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *builtin_init(lenv *e, lval *a);
+/*
+ * 以下函数是原先在 prelude 中用 Lisp 实现的列表函数，直接遍历 cell 实现。
+ * 与 prelude 中的 `fst` 一致，取出的元素先作为单元素 S表达式求值，
+ * 即符号被查找、S表达式被求值，其余元素保持不变。
+ * 参数 `e`: 当前 Lisp 环境，`map`、`filter`、`foldl` 在其中调用函数参数。
+ * 参数 `a`: 参数列表，第一个错误（包括函数参数返回的错误）会被直接返回。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ *
+ * - nth n l: 第 n 个元素（从 0 开始）。
+ * - last l: 最后一个元素。
+ * - take n l, drop n l: 前 n 个元素组成的列表、其余元素组成的列表，
+ *   结果与 l 共享元素（见 `lval_slice`）。
+ * - split n l: 由 take n l 和 drop n l 组成的列表。
+ * - elem x l: x 是否等于 l 的某个元素，返回 1 或 0。
+ * - map f l: 由 f 作用于每个元素的结果组成的列表。
+ * - filter f l: 由 f 返回非零值的元素组成的列表，保留原始（未求值的）元素。
+ * - foldl f z l: 从 z 开始依次用 f 合并每个元素。
+ * - sum l, product l: 元素的和、积。
+ */
+lval *builtin_nth(lenv *e, lval *a);
+lval *builtin_last(lenv *e, lval *a);
+lval *builtin_take(lenv *e, lval *a);
+lval *builtin_drop(lenv *e, lval *a);
+lval *builtin_split(lenv *e, lval *a);
+lval *builtin_elem(lenv *e, lval *a);
+lval *builtin_map(lenv *e, lval *a);
+lval *builtin_filter(lenv *e, lval *a);
+lval *builtin_foldl(lenv *e, lval *a);
+lval *builtin_sum(lenv *e, lval *a);
+lval *builtin_product(lenv *e, lval *a);
+/*
+ * 以下函数操作数值向量（LVAL_VEC），批量运算由 lvec.h 中的内核完成。
+ * 与 `+`、`*` 等内置函数不同，向量运算按 2^64 取模回绕，不报告溢出。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 参数列表。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ *
+ * - vec x...: 由数值 x... 组成的向量，也可以传入一个由数值组成的 Q表达式。
+ * - vec-list v: 由 v 的元素组成的 Q表达式。
+ * - vec-range n: 向量 [0 1 ... n-1]。
+ * - vec-len v: v 的长度。
+ * - vec-slice v i n: 由 v 从下标 i 开始的 n 个元素组成的新向量。
+ * - vec+ v w, vec* v w: 逐个元素的和、积，v 和 w 长度必须相同；
+ *   v 没有被共享时直接写入 v，不分配新的向量。
+ * - vec-dot v w: 点积，v 和 w 长度必须相同。
+ * - vec-sum v, vec-min v, vec-max v: 元素的和、最小值、最大值，
+ *   后两者要求 v 不为空。
+ * - vec-scan v: 前缀和组成的向量，同样在 v 没有被共享时原地计算。
+ */
+lval *builtin_vec(lenv *e, lval *a);
+lval *builtin_vec_list(lenv *e, lval *a);
+lval *builtin_vec_range(lenv *e, lval *a);
+lval *builtin_vec_len(lenv *e, lval *a);
+lval *builtin_vec_slice(lenv *e, lval *a);
+lval *builtin_vec_add(lenv *e, lval *a);
+lval *builtin_vec_mul(lenv *e, lval *a);
+lval *builtin_vec_dot(lenv *e, lval *a);
+lval *builtin_vec_sum(lenv *e, lval *a);
+lval *builtin_vec_min(lenv *e, lval *a);
+lval *builtin_vec_max(lenv *e, lval *a);
+lval *builtin_vec_scan(lenv *e, lval *a);
 /*
  * 定义变量。
  * 参数 `e`: 当前 Lisp 环境。
@@ -294,34 +461,42 @@ lval *builtin_fun(lenv *e, lval *a);
 lval *builtin_exit(lenv *e, lval *a);
 
 /*
- * 执行基本算术和逻辑运算。
+ * 执行基本算术运算（"+", "-", "*", "/"），每个运算符是一个独立的内置函数。
  * 参数 `e`: 当前 Lisp 环境。
- * 参数 `a`: 包含一个或多个数值 lval 的列表。
- * 参数 `op`: 要执行的运算符（"+", "-", "*", "/"）。
- * 返回: 运算结果。
+ * 参数 `a`: 包含数值 lval 的列表，"-" 和 "/" 至少需要一个。
+ * 返回: 从左到右依次运算的结果；结果超出 long 的范围时返回
+ * "Integer Overflow!" 错误，除数为零时返回 "Division By Zero!" 错误。
  * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ * 带 `_fast` 后缀的是同一运算的快速路径（见 `lbuiltin_fast`），
+ * 参数为数组 `a` 中的 `n` 个值，不会被释放。
  */
-lval *builtin_op(lenv *e, lval *a, char *op);
 lval *builtin_add(lenv *e, lval *a);
 lval *builtin_sub(lenv *e, lval *a);
 lval *builtin_mul(lenv *e, lval *a);
 lval *builtin_div(lenv *e, lval *a);
+lval *builtin_add_fast(lenv *e, lval **a, int n);
+lval *builtin_sub_fast(lenv *e, lval **a, int n);
+lval *builtin_mul_fast(lenv *e, lval **a, int n);
+lval *builtin_div_fast(lenv *e, lval **a, int n);
 
 /*
- * 执行数值比较操作。
+ * 执行数值比较操作（">", "<", ">=", "<="），每个运算符是一个独立的内置函数。
  * 参数 `e`: 当前 Lisp 环境。
  * 参数 `a`: 包含两个数值 lval 的列表。
- * 参数 `op`: 比较操作符（">", "<", ">=", "<="）。
  * 返回: 比较结果。
  * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ * 带 `_fast` 后缀的是其快速路径，同算术运算。
  */
-lval *builtin_ord(lenv *e, lval *a, char *op);
 lval *builtin_gt(lenv *e, lval *a);
 lval *builtin_lt(lenv *e, lval *a);
 lval *builtin_ge(lenv *e, lval *a);
 lval *builtin_le(lenv *e, lval *a);
+lval *builtin_gt_fast(lenv *e, lval **a, int n);
+lval *builtin_lt_fast(lenv *e, lval **a, int n);
+lval *builtin_ge_fast(lenv *e, lval **a, int n);
+lval *builtin_le_fast(lenv *e, lval **a, int n);
 /*
  * 执行逻辑比较操作。
  * 参数 `e`: 当前 Lisp 环境。
@@ -334,12 +509,16 @@ lval *builtin_le(lenv *e, lval *a);
 lval *builtin_cmp(lenv *e, lval *a, char *op);
 lval *builtin_eq(lenv *e, lval *a);
 lval *builtin_ne(lenv *e, lval *a);
+lval *builtin_eq_fast(lenv *e, lval **a, int n);
+lval *builtin_ne_fast(lenv *e, lval **a, int n);
 /*
- * 执行逻辑运算。
+ * 执行逻辑运算，参数个数不限。
+ * 以 `and`、`or` 等名称直接调用时，求值器按特殊形式处理：
+ * 参数从左到右逐个求值，结果已经确定时不再求值其余的参数（短路求值）。
  * 参数 `e`: 当前 Lisp 环境。
- * 参数 `a`: 包含两个数值 lval 的列表。
- * 参数 `op`: 逻辑操作符（"&&", "||", "!"）。
- * 返回: 逻辑运算结果。
+ * 参数 `a`: 数值 lval 的列表。
+ * 参数 `op`: 逻辑操作符（"&&", "||"）。
+ * 返回: 逻辑运算结果，为 0 或 1；没有参数时 `and` 为 1，`or` 为 0。
  * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
@@ -347,6 +526,7 @@ lval *builtin_logic(lenv *e, lval *a, char *op);
 lval *builtin_and(lenv *e, lval *a);
 lval *builtin_or(lenv *e, lval *a);
 lval *builtin_not(lenv *e, lval *a);
+lval *builtin_not_fast(lenv *e, lval **a, int n);
 /*
  * 条件执行操作。
  * 参数 `e`: 当前 Lisp 环境。
@@ -356,9 +536,121 @@ lval *builtin_not(lenv *e, lval *a);
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *builtin_if(lenv *e, lval *a);
+/*
+ * 根据条件选出 if 应当执行的分支，但不对其求值。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含条件表达式和两个 Q表达式的列表。
+ * 返回: 类型已改为 S表达式的分支，参数不合法时返回错误。
+ * 原始 lval 'a' 被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_if_branch(lenv *e, lval *a);
+/*
+ * 检查 `and`、`or` 和 `select` 的条件 `x` 是否为数值。
+ * 参数 `func`: 报错时使用的函数名。
+ * 参数 `i`: 报错时使用的参数下标。
+ * 返回: `x` 为数值时返回 NULL；`x` 为错误时返回它的一个共享引用；
+ * 否则返回类型错误。
+ * 原始 lval `x` 的所有权和管理责任仍由调用者持有。
+ */
+lval *builtin_cond(lval *x, char *func, int i);
+/*
+ * 多路条件选择：`(select {条件 值} {条件 值} ...)`。
+ * 依次求值各个条件，返回第一个为真的条件对应的值，其余的值不会被求值。
+ * 条件和值都按 `(eval {x})` 的方式求值，都不为真时返回错误。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含若干个至少有两个元素的 Q表达式的列表。
+ * 返回: 选中的值的求值结果。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_select(lenv *e, lval *a);
+/*
+ * 选出 select 应当求值的值，但不对其求值。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 同 `builtin_select`。
+ * 返回: 由选中的值组成的 S表达式，参数不合法或条件出错时返回错误。
+ * 原始 lval 'a' 被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_select_branch(lenv *e, lval *a);
+/*
+ * 按值选择：`(case x {键 值} {键 值} ...)`。
+ * 依次求值各个键，返回第一个与 `x` 相等（`lval_eq`）的键对应的值，
+ * 其余的键和值不会被求值，都不相等时返回错误。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含 `x` 和若干个至少有两个元素的 Q表达式的列表。
+ * 返回: 选中的值的求值结果。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_case(lenv *e, lval *a);
+/*
+ * 选出 case 应当求值的值，但不对其求值。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 同 `builtin_case`。
+ * 返回: 由选中的值组成的 S表达式，参数不合法或键出错时返回错误。
+ * 原始 lval 'a' 被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_case_branch(lenv *e, lval *a);
+/*
+ * 顺序执行：参数已经按顺序求值，返回最后一个参数，没有参数时返回 {}。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 任意个参数的列表。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_do(lenv *e, lval *a);
+/*
+ * 在新的作用域中对 Q表达式求值，其中用 `=` 定义的变量在求值结束后丢弃。
+ * 参数 `e`: 当前 Lisp 环境，作为新作用域的父环境。
+ * 参数 `a`: 包含一个 Q表达式的列表。
+ * 返回: 求值的结果。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_let(lenv *e, lval *a);
 lval *builtin_load(lenv *e, lval *a);
 lval *builtin_print(lenv *e, lval *a);
 lval *builtin_error(lenv *e, lval *a);
+/*
+ * 在性能分析器下对 Q表达式求值，求值结束后打印报告并写出折叠栈。
+ * 分析器已经在运行（如使用了 `--profile`）时只求值，不单独报告。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含一个 Q表达式的列表。
+ * 返回: 求值的结果。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_profile(lenv *e, lval *a);
+/*
+ * 返回内存统计计数器，格式见 `lstats_list`。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 空的参数列表。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_mem_stats(lenv *e, lval *a);
+/*
+ * 返回 lambda 函数的记忆化版本：`(memo f)` 或 `(memo f 上限)`。
+ * 记忆化函数以参数列表为键缓存调用结果（错误除外），再次以相等的参数调用时
+ * 直接返回缓存的结果，不再求值函数体，缓存的条目数超过上限时淘汰最久未命中的条目。
+ * 键中不包含函数体引用的自由变量，因此只适用于结果只取决于参数的函数。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含一个 lambda 函数和可选的缓存上限（正整数，默认为 `LMEMO_CAP`）的列表。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_memo(lenv *e, lval *a);
+/*
+ * 返回记忆化函数的缓存统计信息，格式见 `lmemo_list`。
+ * 参数 `e`: 当前 Lisp 环境。
+ * 参数 `a`: 包含一个由 `memo` 返回的函数的列表。
+ * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval。
+ */
+lval *builtin_memo_stats(lenv *e, lval *a);
 
 /*
  * 从 lval 中移除并返回指定位置的元素，不删除其余元素。
@@ -367,6 +659,8 @@ lval *builtin_error(lenv *e, lval *a);
  * 返回: 被移除的元素。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  * 注意: 调用此函数后，原始的 lval 'v' 会失去一个元素，其余元素向前移动。
+ * 移除第一个元素为 O(1)，只需将数组的起点后移，不移动其余元素。
+ * `v` 必须是独占的（见 `lval_mut`）。
  */
 lval *lval_pop(lval *v, int i);
 /*
@@ -381,24 +675,30 @@ lval *lval_take(lval *v, int i);
 /*
  * 根据函数 lval 和给定的参数列表调用函数。
  * 参数 `e`: 当前 lisp 环境。
- * 参数 `f`: 函数 lval。
+ * 参数 `f`: 函数 lval，调用过程中不会被修改。
  * 参数 `a`: 包含实际参数的 lval。
  * 返回: 函数调用的结果。
  * 原始 lval 'a' 在求值后被释放，调用者不应再使用它。
+ * 原始 lval `f` 的所有权和管理责任仍由调用者持有。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
 lval *lval_call(lenv *e, lval *f, lval *a);
 /*
- * 对 S表达式 lval 进行求值。
- * 参数 `e`: 当前 Lisp 环境。
- * 参数 `v`: 包含 S表达式的 lval。
- * 返回: 求值后的结果。
- * S表达式中的所有元素，如果任何元素求值为错误，将立即返回错误。
- * 原始 lval 'v' 在求值后被释放，调用者不应再使用它。
+ * 同 `lval_call`，但参数为值栈（见 `lstack`）顶的 `n` 个值，不需要构造参数列表。
+ * 这些值在调用时被弹出并释放。
  * 原始 lval `f` 的所有权和管理责任仍由调用者持有。
  * "调用者"负责使用 `lval_del` 释放返回的 lval。
  */
-lval *lval_eval_sexpr(lenv *e, lval *v);
+lval *lval_apply(lenv *e, lval *f, int n);
+/*
+ * 把值栈顶的 `n` 个值视为一个 S表达式已经求值的各个元素，按求值 S表达式的规则处理。
+ * 返回:
+ *  - 如果表达式为空、含有错误或只有一个非函数的元素，弹出这些值，
+ *    返回表达式的值或错误，`*f` 为 NULL；
+ *  - 否则弹出第一个元素存入 `*f`，其余 `n - 1` 个参数按顺序留在栈顶，返回 NULL。
+ * "调用者"负责使用 `lval_del` 释放返回的 lval 和 `*f`。
+ */
+lval *lval_form(int n, lval **f);
 
 /*
  * 根据 lval 类型获取相应的类型名称字符串。
@@ -421,5 +721,9 @@ void lval_print_str(lval *v);
  * 内部的每个元素，元素之间用空格分隔，最后不带额外空格。
  */
 void lval_expr_print(lval *v, char open, char close);
+/*
+ * 打印数值向量，形如 `[1 2 3]`，元素之间用空格分隔。
+ */
+void lval_vec_print(lval *v);
 
 #endif
@@ -0,0 +1,47 @@
+/*
+ * lvec.h - 本地环境头文件
+ * 此头文件应仅在特定实现中包含，不应对调用者公开。
+ * 包含数值向量（LVAL_VEC）批量运算内核的函数声明。
+ *
+ * 每个内核都有标量实现，在 x86-64 上另有 SSE2 和 AVX2 实现，
+ * 第一次调用时根据 CPU 支持的指令集选定一组，此后不再检查。
+ * 向量的加、乘、点积、求和与前缀和按 2^64 取模回绕，不检测溢出，
+ * 这与 `builtin_add` 等逐个元素检测溢出的内置函数不同。
+ * 所有内核都允许结果 `r` 与输入 `a` 或 `b` 是同一个数组。
+ */
+#ifndef __LVEC_H__
+#define __LVEC_H__
+
+/*
+ * 返回当前选用的指令集的名称："avx2"、"sse2" 或 "scalar"。
+ * 返回值为静态字符串，不应被释放或修改。
+ */
+const char *lvec_isa(void);
+/*
+ * 逐个元素计算 r[i] = a[i] + b[i]，0 <= i < n。
+ */
+void lvec_add(long *r, const long *a, const long *b, int n);
+/*
+ * 逐个元素计算 r[i] = a[i] * b[i]，0 <= i < n。
+ */
+void lvec_mul(long *r, const long *a, const long *b, int n);
+/*
+ * 返回 a 和 b 前 n 个元素的点积。
+ */
+long lvec_dot(const long *a, const long *b, int n);
+/*
+ * 返回 a 前 n 个元素的和，n 为 0 时返回 0。
+ */
+long lvec_sum(const long *a, int n);
+/*
+ * 返回 a 前 n 个元素中的最小值、最大值。
+ * 参数 `n`: 必须大于 0。
+ */
+long lvec_min(const long *a, int n);
+long lvec_max(const long *a, int n);
+/*
+ * 计算前缀和 r[i] = a[0] + ... + a[i]，0 <= i < n。
+ */
+void lvec_scan(long *r, const long *a, int n);
+
+#endif
@@ -0,0 +1,404 @@
+#include <stdio.h>
+
+#include "local-include/lcode.h"
+#include "local-include/lenv.h"
+#include "local-include/lopt.h"
+#include "local-include/lsym.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+#define LOPT_MAX_ARGS 8
+
+int lopt_on = 1;
+static int lopt_dumping = 0;
+
+void lopt_disable(void) { lopt_on = 0; }
+
+void lopt_dump(void) { lopt_dumping = 1; }
+
+lenv *lopt_env(lenv *e) {
+  for (int i = 0; lopt_on && e && i <= LOPT_MAX_DEPTH; i++, e = e->par) {
+    if (e->global) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+void lopt_init(lopt *o, lenv *e, lval *formals) {
+  o->e = e;
+  o->formals = formals;
+  o->keep = lval_qexpr();
+  o->assume = lval_qexpr();
+}
+
+void lopt_quit(lopt *o) {
+  lval_del(o->keep);
+  lval_del(o->assume);
+}
+
+static lval *lopt_keep(lopt *o, lval *x) {
+  o->keep = lval_add(o->keep, x);
+  return x;
+}
+
+/* The index of `x` among the symbols `formals`, or -1. */
+static int lopt_formal(lval *formals, lval *x) {
+  if (x->type != LVAL_SYM) {
+    return -1;
+  }
+  for (int i = 0; i < formals->count; i++) {
+    if (formals->cell[i]->sym == x->sym) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * The global value the symbol `x` names, or NULL when `x` is not a symbol,
+ * is unbound, or is a formal of the function.
+ */
+static lval *lopt_global(lopt *o, lval *x) {
+  if (x->type != LVAL_SYM || lopt_formal(o->formals, x) >= 0) {
+    return NULL;
+  }
+  lval *g;
+  lval_del(lenv_lookup(o->e, x, &g));
+  return g;
+}
+
+static void lopt_assume(lopt *o, lval *sym, lval *val) {
+  for (int i = 0; i < o->assume->count; i++) {
+    if (o->assume->cell[i]->cell[0]->sym == sym->sym) {
+      return;
+    }
+  }
+  lval *p = lval_add(lval_qexpr(), lval_copy(sym));
+  o->assume = lval_add(o->assume, lval_add(p, lval_copy(val)));
+}
+
+/* The value `x` is known to evaluate to, or NULL. */
+static lval *lopt_const(lopt *o, lval *x) {
+  switch (x->type) {
+  case LVAL_SYM: {
+    lval *g = lopt_global(o, x);
+    if (g && g->type == LVAL_NUM) {
+      lopt_assume(o, x, g);
+      return g;
+    }
+    return NULL;
+  }
+  case LVAL_SEXPR: {
+    lval *r = lopt_form(o, x->cell, x->count);
+    return r && r->type != LVAL_SEXPR ? r : NULL;
+  }
+  case LVAL_ERR:
+    return NULL;
+  default:
+    return x;
+  }
+}
+
+/* Fast kernels borrow their arguments and never evaluate, so they can run
+ * at definition time. Errors are left for the call to raise. */
+static lval *lopt_fold(lopt *o, lval *f, lval **cells, int n) {
+  lval *args[LOPT_MAX_ARGS];
+  if (n - 1 > LOPT_MAX_ARGS) {
+    return NULL;
+  }
+  for (int i = 1; i < n; i++) {
+    if (!(args[i - 1] = lopt_const(o, cells[i]))) {
+      return NULL;
+    }
+  }
+  lval *x = f->fast(o->e, args, n - 1);
+  if (x->type == LVAL_ERR) {
+    lval_del(x);
+    return NULL;
+  }
+  return lopt_keep(o, x);
+}
+
+/* `if` with a constant condition, as the branch it takes. */
+static lval *lopt_branch(lopt *o, lval **cells, int n) {
+  if (n != 4 || cells[2]->type != LVAL_QEXPR ||
+      cells[3]->type != LVAL_QEXPR) {
+    return NULL;
+  }
+  lval *c = lopt_const(o, cells[1]);
+  if (!c || c->type != LVAL_NUM) {
+    return NULL;
+  }
+  lval *x = lval_mut(lval_copy(cells[c->num ? 2 : 3]));
+  x->type = LVAL_SEXPR;
+  return lopt_keep(o, x);
+}
+
+/* Builtins that neither evaluate code nor touch the frame they are called
+ * from, besides those with a fast kernel, which never do. A wrapper calling
+ * anything else would see or change its caller's bindings once inlined, so
+ * builtins are left out until they are known to be safe. */
+static const lbuiltin lopt_pure[] = {
+    builtin_list, builtin_head, builtin_tail,
+    builtin_join, builtin_cons, builtin_init,
+};
+
+static int lopt_frame_free(lval *f) {
+  if (f->fast) {
+    return 1;
+  }
+  for (int i = 0; i < (int)(sizeof lopt_pure / sizeof lopt_pure[0]); i++) {
+    if (f->builtin == lopt_pure[i]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Whether the form `cells` in the body of the wrapper `f` only looks up its
+ * formals and builtins that do not depend on its frame, each formal once and
+ * in order (`*seen` of them so far), and calls nothing before the last formal
+ * is evaluated. Then the arguments are evaluated just as they would be before
+ * the call.
+ */
+static int lopt_simple(lopt *o, lval *f, lval **cells, int n, int *seen) {
+  if (n == 0) {
+    return 0;
+  }
+  for (int i = 0; i < n; i++) {
+    lval *x = cells[i];
+    int j = lopt_formal(f->formals, x);
+    if (j >= 0) {
+      if (i == 0 || j != *seen) {
+        return 0;
+      }
+      (*seen)++;
+    } else if (x->type == LVAL_SYM) {
+      lval *g = lopt_global(o, x);
+      if (!g || g->type != LVAL_FUN || !g->builtin || !lopt_frame_free(g)) {
+        return 0;
+      }
+    } else if (x->type == LVAL_SEXPR) {
+      if (!lopt_simple(o, f, x->cell, x->count, seen)) {
+        return 0;
+      }
+    } else if (x->type != LVAL_NUM && x->type != LVAL_STR) {
+      return 0;
+    }
+  }
+  return *seen == f->formals->count;
+}
+
+static lval *lopt_subst(lopt *o, lval *f, lval *x, lval **args) {
+  int j = lopt_formal(f->formals, x);
+  if (j >= 0) {
+    return lval_copy(args[j]);
+  }
+  if (x->type == LVAL_SYM) {
+    lopt_assume(o, x, lopt_global(o, x));
+  }
+  if (x->type != LVAL_SEXPR) {
+    return lval_copy(x);
+  }
+  lval *y = lval_sexpr();
+  for (int i = 0; i < x->count; i++) {
+    y = lval_add(y, lopt_subst(o, f, x->cell[i], args));
+  }
+  return y;
+}
+
+/* A call to the wrapper `f`, as its body with the arguments in place. */
+static lval *lopt_inline(lopt *o, lval *f, lval **cells, int n) {
+  lval *formals = f->formals;
+  if (f->env || f->code->memo || formals->count != n - 1) {
+    return NULL;
+  }
+  char *amp = lsym_intern("&");
+  for (int i = 0; i < formals->count; i++) {
+    if (formals->cell[i]->sym == amp ||
+        lopt_formal(formals, formals->cell[i]) != i) {
+      return NULL;
+    }
+  }
+  int seen = 0;
+  if (!lopt_simple(o, f, f->body->cell, f->body->count, &seen)) {
+    return NULL;
+  }
+  lval *x = lval_sexpr();
+  for (int i = 0; i < f->body->count; i++) {
+    x = lval_add(x, lopt_subst(o, f, f->body->cell[i], cells + 1));
+  }
+  return lopt_keep(o, x);
+}
+
+lval *lopt_form(lopt *o, lval **cells, int n) {
+  lval *f = n ? lopt_global(o, cells[0]) : NULL;
+  if (!f || f->type != LVAL_FUN) {
+    return NULL;
+  }
+  lval *x = NULL;
+  if (f->builtin == builtin_if) {
+    x = lopt_branch(o, cells, n);
+  } else if (f->builtin && f->fast) {
+    x = lopt_fold(o, f, cells, n);
+  } else if (!f->builtin) {
+    x = lopt_inline(o, f, cells, n);
+  }
+  if (!x) {
+    return NULL;
+  }
+  lopt_assume(o, cells[0], f);
+  if (x->type == LVAL_SEXPR) {
+    lval *y = lopt_form(o, x->cell, x->count);
+    if (y) {
+      x = y;
+    }
+  }
+  return x;
+}
+
+/* The argument counts the builtins assert on, other than variadic ones. The
+ * list builtins also take fewer, giving a partial application. */
+static const struct {
+  lbuiltin builtin;
+  int count;
+  int curry;
+} lopt_arities[] = {
+    {builtin_head, 1},        {builtin_tail, 1},
+    {builtin_eval, 1},        {builtin_cons, 2},
+    {builtin_len, 1, 1},      {builtin_init, 1},
+    {builtin_nth, 2, 1},      {builtin_last, 1, 1},
+    {builtin_take, 2, 1},     {builtin_drop, 2, 1},
+    {builtin_split, 2, 1},    {builtin_elem, 2, 1},
+    {builtin_map, 2, 1},      {builtin_filter, 2, 1},
+    {builtin_foldl, 3, 1},    {builtin_sum, 1, 1},
+    {builtin_product, 1, 1},  {builtin_vec_list, 1},
+    {builtin_vec_range, 1},   {builtin_vec_len, 1},
+    {builtin_vec_slice, 3},   {builtin_vec_add, 2},
+    {builtin_vec_mul, 2},     {builtin_vec_dot, 2},
+    {builtin_vec_sum, 1},     {builtin_vec_min, 1},
+    {builtin_vec_max, 1},     {builtin_vec_scan, 1},
+    {builtin_lambda, 2},      {builtin_fun, 2},
+    {builtin_load, 1},        {builtin_error, 1},
+    {builtin_profile, 1},     {builtin_mem_stats, 0},
+    {builtin_memo_stats, 1},  {builtin_gt, 2},
+    {builtin_lt, 2},          {builtin_ge, 2},
+    {builtin_le, 2},          {builtin_eq, 2},
+    {builtin_ne, 2},          {builtin_not, 1},
+    {builtin_if, 3},          {builtin_let, 1},
+};
+
+/* Whether argument `i` of a call to the builtin `f` is a Q-Expression of
+ * code, as the compiler treats `if` branches and `select` and `case` cases. */
+static int lopt_code(lval *f, int i) {
+  return (f->builtin == builtin_if && i >= 2) ||
+         f->builtin == builtin_select || (f->builtin == builtin_case && i >= 2);
+}
+
+static void lopt_warn(lopt *o, lval **cells, int n) {
+  lval *f = n ? lopt_global(o, cells[0]) : NULL;
+  if (f && (f->type != LVAL_FUN || !f->builtin)) {
+    f = NULL;
+  }
+  for (int i = 0; f && i < (int)(sizeof lopt_arities / sizeof lopt_arities[0]);
+       i++) {
+    if (lopt_arities[i].builtin == f->builtin &&
+        lopt_arities[i].count != n - 1 &&
+        !(lopt_arities[i].curry && n - 1 < lopt_arities[i].count)) {
+      fprintf(stderr,
+              "Warning: Function '%s' passed incorrect number of arguments. "
+              "Got %i, Expected %i.\n",
+              cells[0]->sym, n - 1, lopt_arities[i].count);
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    lval *x = cells[i];
+    if (x->type == LVAL_SEXPR) {
+      lopt_warn(o, x->cell, x->count);
+    } else if (x->type == LVAL_QEXPR && f && lopt_code(f, i)) {
+      if (f->builtin == builtin_if) {
+        lopt_warn(o, x->cell, x->count);
+        continue;
+      }
+      for (int j = 0; j < x->count; j++) {
+        if (x->cell[j]->type == LVAL_SEXPR) {
+          lopt_warn(o, x->cell[j]->cell, x->cell[j]->count);
+        }
+      }
+    }
+  }
+}
+
+static lval *lopt_view(lopt *o, lval **cells, int n, int type);
+
+static lval *lopt_view_expr(lopt *o, lval *x) {
+  if (x->type == LVAL_SEXPR) {
+    return lopt_view(o, x->cell, x->count, LVAL_SEXPR);
+  }
+  return lval_copy(x);
+}
+
+/* The form `cells` as a value of `type`, rewritten as the compiler does. */
+static lval *lopt_view(lopt *o, lval **cells, int n, int type) {
+  lval *v = type == LVAL_SEXPR ? lval_sexpr() : lval_qexpr();
+  lval *r = lopt_form(o, cells, n);
+  if (r && r->type != LVAL_SEXPR) {
+    if (type == LVAL_SEXPR) {
+      lval_del(v);
+      return lval_copy(r);
+    }
+    return lval_add(v, lval_copy(r));
+  }
+  if (r) {
+    cells = r->cell;
+    n = r->count;
+  }
+
+  lval *f = n ? lopt_global(o, cells[0]) : NULL;
+  if (f && (f->type != LVAL_FUN || !f->builtin)) {
+    f = NULL;
+  }
+  for (int i = 0; i < n; i++) {
+    lval *x = cells[i];
+    if (x->type == LVAL_QEXPR && f && lopt_code(f, i)) {
+      if (f->builtin == builtin_if) {
+        v = lval_add(v, lopt_view(o, x->cell, x->count, LVAL_QEXPR));
+        continue;
+      }
+      lval *y = lval_qexpr();
+      for (int j = 0; j < x->count; j++) {
+        y = lval_add(y, lopt_view_expr(o, x->cell[j]));
+      }
+      v = lval_add(v, y);
+    } else {
+      v = lval_add(v, lopt_view_expr(o, x));
+    }
+  }
+  return v;
+}
+
+void lopt_check(lenv *e, lval *formals, lval *body) {
+  lenv *g = lopt_env(e);
+  if (!g) {
+    return;
+  }
+  lopt o;
+  lopt_init(&o, g, formals);
+  lopt_warn(&o, body->cell, body->count);
+  if (lopt_dumping) {
+    lval *v = lopt_view(&o, body->cell, body->count, LVAL_QEXPR);
+    printf("opt: (\\ ");
+    lval_print(formals);
+    putchar(' ');
+    lval_print(body);
+    printf(") => (\\ ");
+    lval_print(formals);
+    putchar(' ');
+    lval_print(v);
+    printf(")\n");
+    lval_del(v);
+  }
+  lopt_quit(&o);
+}
@@ -0,0 +1,376 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "local-include/lcode.h"
+#include "local-include/lprof.h"
+#include "local-include/lsym.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+#define LPROF_INTERVAL_US 1000
+#define LPROF_MAX_STACK 128
+
+typedef struct lprof_fn {
+  char *name;
+  long calls;
+  long allocs;
+  long samples;
+  int active;
+  double total;
+  double self;
+} lprof_fn;
+
+typedef struct {
+  lprof_fn *fn;
+  double start;
+  double child;
+} lprof_frame;
+
+typedef struct lprof_stack lprof_stack;
+struct lprof_stack {
+  lprof_stack *next;
+  int depth;
+  long count;
+  lprof_fn *fns[];
+};
+
+/* Open addressing from a non-zero key to a pointer. */
+typedef struct {
+  uintptr_t *keys;
+  void **vals;
+  int mask;
+  int count;
+} lprof_map;
+
+int lprof_on;
+
+static volatile sig_atomic_t lprof_pending;
+
+static struct {
+  int sample;
+  const char *output;
+  double begin;
+  long calls;
+  long allocs;
+  long samples;
+  lprof_map builtins;
+  lprof_map fns;
+  lprof_map stacks;
+  lprof_fn *toplevel;
+  lprof_frame *frames;
+  int depth;
+  int cap;
+} lprof = {.output = "profile.folded"};
+
+static double lprof_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static uintptr_t lprof_mix(uintptr_t k) {
+  k ^= k >> 33;
+  k *= (uintptr_t)0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return k;
+}
+
+static void **lprof_map_slot(lprof_map *m, uintptr_t key);
+
+static void lprof_map_grow(lprof_map *m) {
+  lprof_map old = *m;
+  int size = old.keys ? (old.mask + 1) * 2 : 64;
+  m->keys = calloc(size, sizeof(uintptr_t));
+  m->vals = malloc(sizeof(void *) * size);
+  m->mask = size - 1;
+  m->count = 0;
+  for (int i = 0; old.keys && i <= old.mask; i++) {
+    if (old.keys[i]) {
+      *lprof_map_slot(m, old.keys[i]) = old.vals[i];
+    }
+  }
+  free(old.keys);
+  free(old.vals);
+}
+
+/* The value slot of `key`, inserted with a NULL value if absent. */
+static void **lprof_map_slot(lprof_map *m, uintptr_t key) {
+  if (2 * (m->count + 1) > m->mask + 1) {
+    lprof_map_grow(m);
+  }
+  for (uintptr_t i = lprof_mix(key) & m->mask;; i = (i + 1) & m->mask) {
+    if (m->keys[i] == key) {
+      return &m->vals[i];
+    }
+    if (!m->keys[i]) {
+      m->keys[i] = key;
+      m->vals[i] = NULL;
+      m->count++;
+      return &m->vals[i];
+    }
+  }
+}
+
+static void lprof_map_free(lprof_map *m, int vals) {
+  for (int i = 0; vals && m->keys && i <= m->mask; i++) {
+    if (m->keys[i]) {
+      free(m->vals[i]);
+    }
+  }
+  free(m->keys);
+  free(m->vals);
+  memset(m, 0, sizeof *m);
+}
+
+static lprof_fn *lprof_fn_named(char *name) {
+  void **slot = lprof_map_slot(&lprof.fns, (uintptr_t)name);
+  if (!*slot) {
+    lprof_fn *fn = calloc(1, sizeof(lprof_fn));
+    fn->name = name;
+    *slot = fn;
+  }
+  return *slot;
+}
+
+static lprof_fn *lprof_fn_of(lval *f) {
+  char *name;
+  if (f->builtin) {
+    name = *lprof_map_slot(&lprof.builtins, (uintptr_t)f->builtin);
+    name = name ? name : lsym_intern("<builtin>");
+  } else {
+    name = f->code->name ? f->code->name : lsym_intern("<lambda>");
+  }
+  return lprof_fn_named(name);
+}
+
+static lprof_fn *lprof_top(void) {
+  return lprof.depth ? lprof.frames[lprof.depth - 1].fn : lprof.toplevel;
+}
+
+/* Record the pending timer ticks against the current shadow stack. */
+static void lprof_flush(void) {
+  long n = lprof_pending;
+  lprof_pending = 0;
+  lprof_top()->samples += n;
+  lprof.samples += n;
+
+  /* Very deep stacks keep their outermost frames and the innermost one. */
+  lprof_fn *fns[LPROF_MAX_STACK];
+  int depth = 0;
+  if (!lprof.depth) {
+    fns[depth++] = lprof.toplevel;
+  }
+  for (int i = 0; i < lprof.depth && depth < LPROF_MAX_STACK - 1; i++) {
+    fns[depth++] = lprof.frames[i].fn;
+  }
+  if (lprof.depth >= LPROF_MAX_STACK) {
+    fns[depth++] = lprof_top();
+  }
+
+  uintptr_t hash = depth;
+  for (int i = 0; i < depth; i++) {
+    hash = lprof_mix(hash ^ (uintptr_t)fns[i]);
+  }
+  void **slot = lprof_map_slot(&lprof.stacks, hash | 1);
+  for (lprof_stack *s = *slot; s; s = s->next) {
+    if (s->depth == depth && !memcmp(s->fns, fns, sizeof(lprof_fn *) * depth)) {
+      s->count += n;
+      return;
+    }
+  }
+  lprof_stack *s = malloc(sizeof(lprof_stack) + sizeof(lprof_fn *) * depth);
+  s->next = *slot;
+  s->depth = depth;
+  s->count = n;
+  memcpy(s->fns, fns, sizeof(lprof_fn *) * depth);
+  *slot = s;
+}
+
+static void lprof_tick(int sig) { lprof_pending++; }
+
+static void lprof_timer(long us) {
+  struct itimerval it = {{0, us}, {0, us}};
+  setitimer(ITIMER_PROF, &it, NULL);
+}
+
+int lprof_start(int sample) {
+  if (lprof_on) {
+    return 0;
+  }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof sa);
+  sa.sa_handler = lprof_tick;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGPROF, &sa, NULL);
+
+  lprof.sample = sample;
+  lprof.calls = 0;
+  lprof.allocs = 0;
+  lprof.samples = 0;
+  lprof.depth = 0;
+  lprof.toplevel = lprof_fn_named(lsym_intern("<toplevel>"));
+  lprof_pending = 0;
+  lprof_on = 1;
+  lprof.begin = lprof_now();
+  lprof_timer(LPROF_INTERVAL_US);
+  return 1;
+}
+
+void lprof_output(const char *filename) { lprof.output = filename; }
+
+void lprof_name(lval *f, char *name) {
+  if (f->builtin) {
+    void **slot = lprof_map_slot(&lprof.builtins, (uintptr_t)f->builtin);
+    if (!*slot) {
+      *slot = name;
+    }
+  } else if (!f->code->name) {
+    f->code->name = name;
+  }
+}
+
+void lprof_enter(lval *f) {
+  if (lprof_pending) {
+    lprof_flush();
+  }
+  if (lprof.depth == lprof.cap) {
+    lprof.cap = lprof.cap ? lprof.cap * 2 : 64;
+    lprof.frames = realloc(lprof.frames, sizeof(lprof_frame) * lprof.cap);
+  }
+  lprof_frame *p = &lprof.frames[lprof.depth++];
+  p->fn = lprof_fn_of(f);
+  p->fn->calls++;
+  p->fn->active++;
+  p->child = 0;
+  p->start = lprof.sample ? 0 : lprof_now();
+  lprof.calls++;
+}
+
+void lprof_leave(void) {
+  if (lprof_pending) {
+    lprof_flush();
+  }
+  if (!lprof.depth) {
+    return;
+  }
+  lprof_frame *p = &lprof.frames[--lprof.depth];
+  lprof_fn *fn = p->fn;
+  fn->active--;
+  if (lprof.sample) {
+    return;
+  }
+  double t = lprof_now() - p->start;
+  fn->self += t - p->child;
+  /* Recursive calls are inside the outermost one's total already. */
+  if (!fn->active) {
+    fn->total += t;
+  }
+  if (lprof.depth) {
+    lprof.frames[lprof.depth - 1].child += t;
+  }
+}
+
+void lprof_alloc(void) {
+  lprof_top()->allocs++;
+  lprof.allocs++;
+}
+
+static int lprof_cmp(const void *a, const void *b) {
+  const lprof_fn *x = *(lprof_fn *const *)a;
+  const lprof_fn *y = *(lprof_fn *const *)b;
+  double dx = lprof.sample ? x->samples : x->self;
+  double dy = lprof.sample ? y->samples : y->self;
+  if (dx != dy) {
+    return dx < dy ? 1 : -1;
+  }
+  return (x->calls < y->calls) - (x->calls > y->calls);
+}
+
+static void lprof_write(void) {
+  FILE *f = fopen(lprof.output, "w");
+  if (!f) {
+    printf("profile: cannot write %s\n", lprof.output);
+    return;
+  }
+  for (int i = 0; i <= lprof.stacks.mask && lprof.stacks.keys; i++) {
+    if (!lprof.stacks.keys[i]) {
+      continue;
+    }
+    for (lprof_stack *s = lprof.stacks.vals[i]; s; s = s->next) {
+      for (int j = 0; j < s->depth; j++) {
+        fprintf(f, j ? ";%s" : "%s", s->fns[j]->name);
+      }
+      fprintf(f, " %ld\n", s->count);
+    }
+  }
+  fclose(f);
+  printf("profile: %ld samples written to %s\n", lprof.samples, lprof.output);
+}
+
+void lprof_report(void) {
+  if (!lprof_on) {
+    return;
+  }
+  lprof_timer(0);
+  if (lprof_pending) {
+    lprof_flush();
+  }
+  lprof_on = 0;
+  double elapsed = lprof_now() - lprof.begin;
+
+  int n = 0;
+  lprof_fn **fns = malloc(sizeof(lprof_fn *) * (lprof.fns.count + 1));
+  for (int i = 0; i <= lprof.fns.mask; i++) {
+    lprof_fn *fn = lprof.fns.keys[i] ? lprof.fns.vals[i] : NULL;
+    if (fn && (fn->calls || fn->samples || fn->allocs)) {
+      fns[n++] = fn;
+    }
+  }
+  qsort(fns, n, sizeof(lprof_fn *), lprof_cmp);
+
+  printf("profile: %.3f s, %ld calls, %ld allocations, %ld samples\n", elapsed,
+         lprof.calls, lprof.allocs, lprof.samples);
+  if (lprof.sample) {
+    printf("%12s %12s %8s  %s\n", "calls", "allocs", "samples", "function");
+  } else {
+    printf("%12s %12s %12s %12s %8s  %s\n", "calls", "total ms", "self ms",
+           "allocs", "samples", "function");
+  }
+  for (int i = 0; i < n; i++) {
+    lprof_fn *fn = fns[i];
+    if (lprof.sample) {
+      printf("%12ld %12ld %8ld  %s\n", fn->calls, fn->allocs, fn->samples,
+             fn->name);
+    } else {
+      printf("%12ld %12.3f %12.3f %12ld %8ld  %s\n", fn->calls,
+             fn->total * 1e3, fn->self * 1e3, fn->allocs, fn->samples,
+             fn->name);
+    }
+  }
+  free(fns);
+  lprof_write();
+
+  for (int i = 0; lprof.stacks.keys && i <= lprof.stacks.mask; i++) {
+    lprof_stack *s = lprof.stacks.keys[i] ? lprof.stacks.vals[i] : NULL;
+    while (s) {
+      lprof_stack *next = s->next;
+      free(s);
+      s = next;
+    }
+  }
+  lprof_map_free(&lprof.stacks, 0);
+  lprof_map_free(&lprof.fns, 1);
+  free(lprof.frames);
+  lprof.frames = NULL;
+  lprof.depth = 0;
+  lprof.cap = 0;
+}
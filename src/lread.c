@@ -0,0 +1,303 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "local-include/lread.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+#define LREAD_WINDOW (1 << 20)
+
+static int lread_is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+static int lread_is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static int lread_is_sym(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         lread_is_digit(c) || (c && strchr("_+-*/\\=<>!&|", c));
+}
+
+static void lread_space(lreader *r) {
+  while (r->p < r->end && lread_is_space(*r->p)) {
+    r->p++;
+  }
+}
+
+static lval *lread_fail(lreader *r, const char *msg) {
+  int row = 1;
+  int col = 1;
+  for (const char *s = r->buf; s < r->p; s++) {
+    if (*s == '\n') {
+      row++;
+      col = 1;
+    } else {
+      col++;
+    }
+  }
+  r->err = lval_err("%s:%i:%i: error: %s", r->name, row, col, msg);
+  return NULL;
+}
+
+static lval *lread_num(const char *s, const char *end) {
+  int neg = *s == '-';
+  long x = 0;
+  for (s += neg; s < end; s++) {
+    int d = *s - '0';
+    if (neg ? x < (LONG_MIN + d) / 10 : x > (LONG_MAX - d) / 10) {
+      return lval_err("invalid number");
+    }
+    x = x * 10 + (neg ? -d : d);
+  }
+  return lval_num(x);
+}
+
+/* The same escapes as mpcf_unescape; "\0" is dropped, as it is there. */
+static int lread_escape(char c) {
+  switch (c) {
+  case 'a':
+    return '\a';
+  case 'b':
+    return '\b';
+  case 'f':
+    return '\f';
+  case 'n':
+    return '\n';
+  case 'r':
+    return '\r';
+  case 't':
+    return '\t';
+  case 'v':
+    return '\v';
+  case '\\':
+  case '\'':
+  case '"':
+    return c;
+  case '0':
+    return 0;
+  }
+  return -1;
+}
+
+static lval *lread_str(lreader *r) {
+  const char *s = r->p + 1;
+  const char *q = s;
+  while (q < r->end && *q != '"') {
+    q += (*q == '\\' && q + 1 < r->end) ? 2 : 1;
+  }
+  if (q == r->end) {
+    return lread_fail(r, "unterminated string");
+  }
+
+  /* Copy once, then unescape in place: escapes only ever shrink. */
+  lval *x = lval_str_n(s, q - s);
+  char *i = x->str;
+  char *o = x->str;
+  while (*i) {
+    int c = i[0] == '\\' && i[1] ? lread_escape(i[1]) : -1;
+    if (c < 0) {
+      *o++ = *i++;
+      continue;
+    }
+    if (c) {
+      *o++ = c;
+    }
+    i += 2;
+  }
+  *o = '\0';
+
+  r->p = q + 1;
+  lread_space(r);
+  return x;
+}
+
+static lval *lread_expr(lreader *r);
+
+static lval *lread_list(lreader *r, lval *x, char close) {
+  r->p++;
+  lread_space(r);
+  while (r->p < r->end && *r->p != close) {
+    lval *y = lread_expr(r);
+    if (!y) {
+      lval_del(x);
+      return NULL;
+    }
+    x = lval_add(x, y);
+  }
+  if (r->p == r->end) {
+    lval_del(x);
+    return lread_fail(r, close == ')' ? "expected ')'" : "expected '}'");
+  }
+  r->p++;
+  lread_space(r);
+  return x;
+}
+
+static lval *lread_expr(lreader *r) {
+  const char *p = r->p;
+  if (*p == '(') {
+    return lread_list(r, lval_sexpr(), ')');
+  }
+  if (*p == '{') {
+    return lread_list(r, lval_qexpr(), '}');
+  }
+  if (*p == '"') {
+    return lread_str(r);
+  }
+
+  const char *q = p + (*p == '-');
+  while (q < r->end && lread_is_digit(*q)) {
+    q++;
+  }
+  if (q > p + (*p == '-')) {
+    r->p = q;
+    lread_space(r);
+    return lread_num(p, q);
+  }
+
+  q = p;
+  while (q < r->end && lread_is_sym(*q)) {
+    q++;
+  }
+  if (q > p) {
+    r->p = q;
+    lread_space(r);
+    return lval_sym_n(p, q - p);
+  }
+  return lread_fail(r, "expected expression");
+}
+
+void lread_init(lreader *r, const char *name, const char *s, size_t len) {
+  r->name = name;
+  r->buf = s;
+  r->p = s;
+  r->end = s + len;
+  r->err = NULL;
+  r->data = NULL;
+  r->size = 0;
+  r->mapped = 0;
+  r->released = 0;
+}
+
+int lread_open(lreader *r, const char *filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || S_ISDIR(st.st_mode)) {
+    close(fd);
+    return 0;
+  }
+
+  void *data = NULL;
+  size_t size = 0;
+  int mapped = 0;
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    size = st.st_size;
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return 0;
+    }
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    mapped = 1;
+  } else if (!S_ISREG(st.st_mode)) {
+    size_t cap = 4096;
+    data = malloc(cap);
+    ssize_t n;
+    while ((n = read(fd, (char *)data + size, cap - size)) > 0) {
+      size += n;
+      if (size == cap) {
+        cap *= 2;
+        data = realloc(data, cap);
+      }
+    }
+  }
+  close(fd);
+
+  lread_init(r, filename, data ? data : "", size);
+  r->data = data;
+  r->size = size;
+  r->mapped = mapped;
+  return 1;
+}
+
+void lread_close(lreader *r) {
+  if (r->mapped) {
+    munmap(r->data, r->size);
+  } else {
+    free(r->data);
+  }
+  if (r->err) {
+    lval_del(r->err);
+  }
+  r->data = NULL;
+  r->size = 0;
+  r->mapped = 0;
+  r->err = NULL;
+}
+
+/* Drop mapped pages already read, so a large file is not kept resident. */
+static void lread_release(lreader *r) {
+  size_t done = (r->p - (char *)r->data) & ~(size_t)(LREAD_WINDOW - 1);
+  if (done > r->released) {
+    madvise((char *)r->data + r->released, done - r->released, MADV_DONTNEED);
+    r->released = done;
+  }
+}
+
+lval *lread_next(lreader *r) {
+  for (;;) {
+    lread_space(r);
+    if (r->p == r->end) {
+      return NULL;
+    }
+    if (*r->p != ';') {
+      break;
+    }
+    while (r->p < r->end && *r->p != '\n' && *r->p != '\r') {
+      r->p++;
+    }
+  }
+
+  lval *x = NULL;
+  if (*r->p == '(') {
+    x = lread_list(r, lval_sexpr(), ')');
+  } else {
+    lread_fail(r, "expected '(' or ';' at top level");
+  }
+  if (!x) {
+    x = r->err;
+    r->err = NULL;
+    r->p = r->end;
+  }
+  if (r->mapped) {
+    lread_release(r);
+  }
+  return x;
+}
+
+lval *lread_all(const char *name, const char *s, size_t len) {
+  lreader r;
+  lread_init(&r, name, s, len);
+  lval *v = lval_sexpr();
+  lval *x;
+  while ((x = lread_next(&r))) {
+    if (x->type == LVAL_ERR) {
+      lval_del(v);
+      return x;
+    }
+    v = lval_add(v, x);
+  }
+  return v;
+}
@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "local-include/lstack.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+struct lstack lstack;
+
+void lstack_reserve(int n) {
+  if (lstack.sp + n <= lstack.cap) {
+    return;
+  }
+  lstack.cap = lstack.cap ? lstack.cap * 2 : 256;
+  while (lstack.cap < lstack.sp + n) {
+    lstack.cap *= 2;
+  }
+  lstack.vals = realloc(lstack.vals, sizeof(lval *) * lstack.cap);
+}
+
+void lstack_push(lval *x) {
+  lstack_reserve(1);
+  lstack.vals[lstack.sp++] = x;
+}
+
+void lstack_drop(int n) {
+  while (n--) {
+    lval_del(lstack.vals[--lstack.sp]);
+  }
+}
+
+lval *lstack_list(int n) {
+  lval *a = lval_sexpr();
+  if (n) {
+    lval_reserve(a, n);
+    lstack.sp -= n;
+    memcpy(a->cell, &lstack.vals[lstack.sp], sizeof(lval *) * n);
+    a->count = n;
+  }
+  return a;
+}
+
+void lstack_quit(void) {
+  free(lstack.vals);
+  memset(&lstack, 0, sizeof lstack);
+}
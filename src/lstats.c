@@ -0,0 +1,70 @@
+#include <stdio.h>
+
+#include "local-include/lstats.h"
+#include "local-include/lval.h"
+#include <clisp.h>
+
+struct lstats lstats;
+
+static const char *lstats_kind_name(int kind) {
+  static const char *names[LSTATS_KINDS] = {
+      [LVAL_ERR] = "err", [LVAL_NUM] = "num",    [LVAL_SYM] = "sym",
+      [LVAL_STR] = "str", [LVAL_FUN] = "fun",    [LVAL_SEXPR] = "expr",
+      [LVAL_VEC] = "vec",
+  };
+  return names[kind];
+}
+
+static lval *lstats_pair(lval *x, const char *name, long n) {
+  lval *p = lval_add(lval_qexpr(), lval_sym((char *)name));
+  return lval_add(x, lval_add(p, lval_num(n)));
+}
+
+lval *lstats_list(void) {
+  /* Taken first, so building the list does not change what it reports. */
+  struct lstats s = lstats;
+  char name[32];
+  lval *x = lval_qexpr();
+  for (int k = 0; k < LSTATS_KINDS; k++) {
+    if (lstats_kind_name(k)) {
+      snprintf(name, sizeof name, "made-%s", lstats_kind_name(k));
+      x = lstats_pair(x, name, s.made[k]);
+    }
+  }
+  for (int k = 0; k < LSTATS_KINDS; k++) {
+    if (lstats_kind_name(k)) {
+      snprintf(name, sizeof name, "live-%s", lstats_kind_name(k));
+      x = lstats_pair(x, name, s.live[k]);
+    }
+  }
+  x = lstats_pair(x, "live", s.live_total);
+  x = lstats_pair(x, "peak", s.peak);
+  x = lstats_pair(x, "shared", s.shared);
+  x = lstats_pair(x, "copies", s.copies);
+  x = lstats_pair(x, "clones", s.clones);
+  x = lstats_pair(x, "clone-bytes", s.clone_bytes);
+  x = lstats_pair(x, "envs", s.envs);
+  x = lstats_pair(x, "env-shares", s.env_shares);
+  x = lstats_pair(x, "live-envs", s.env_live);
+  x = lstats_pair(x, "peak-envs", s.env_peak);
+  x = lstats_pair(x, "cells", s.cells);
+  x = lstats_pair(x, "cell-bytes", s.cell_bytes);
+  return x;
+}
+
+void lstats_report(void) {
+  if (!lstats.live_total && !lstats.env_live) {
+    return;
+  }
+  fprintf(stderr, "mem: %ld values and %ld environments still live at exit",
+          lstats.live_total, lstats.env_live);
+  const char *sep = " (";
+  for (int k = 0; k < LSTATS_KINDS; k++) {
+    if (lstats.live[k]) {
+      fprintf(stderr, "%s%s %ld", sep,
+              k == LVAL_SEXPR ? "Expression" : ltype_name(k), lstats.live[k]);
+      sep = ", ";
+    }
+  }
+  fprintf(stderr, "%s\n", lstats.live_total ? ")" : "");
+}
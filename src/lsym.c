@@ -0,0 +1,102 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "local-include/lsym.h"
+#include <clisp.h>
+
+/* The hash and the version stamp fit in one word without padding. */
+typedef struct lsym_entry {
+  unsigned hash;
+  unsigned cached;
+  lval val;
+  char name[];
+} lsym_entry;
+
+static struct {
+  lsym_entry **slots;
+  int count;
+  int cap;
+} lsym;
+
+static lsym_entry *lsym_entry_of(const char *sym) {
+  return (lsym_entry *)(sym - offsetof(lsym_entry, name));
+}
+
+static unsigned lsym_hash_str(const char *s, size_t n) {
+  /* FNV-1a */
+  unsigned h = 2166136261U;
+  for (size_t i = 0; i < n; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+static void lsym_grow(void) {
+  int cap = lsym.cap ? lsym.cap * 2 : 256;
+  lsym_entry **slots = calloc(cap, sizeof(lsym_entry *));
+  for (int i = 0; i < lsym.cap; i++) {
+    lsym_entry *x = lsym.slots[i];
+    if (x) {
+      int j = x->hash & (cap - 1);
+      while (slots[j]) {
+        j = (j + 1) & (cap - 1);
+      }
+      slots[j] = x;
+    }
+  }
+  free(lsym.slots);
+  lsym.slots = slots;
+  lsym.cap = cap;
+}
+
+char *lsym_intern(const char *s) { return lsym_intern_n(s, strlen(s)); }
+
+char *lsym_intern_n(const char *s, size_t n) {
+  if ((lsym.count + 1) * 4 > lsym.cap * 3) {
+    lsym_grow();
+  }
+
+  unsigned h = lsym_hash_str(s, n);
+  int i = h & (lsym.cap - 1);
+  while (lsym.slots[i]) {
+    lsym_entry *x = lsym.slots[i];
+    if (x->hash == h && strncmp(x->name, s, n) == 0 && x->name[n] == '\0') {
+      return x->name;
+    }
+    i = (i + 1) & (lsym.cap - 1);
+  }
+
+  lsym_entry *x = malloc(sizeof(lsym_entry) + n + 1);
+  x->hash = h;
+  x->cached = 0;
+  memcpy(x->name, s, n);
+  x->name[n] = '\0';
+  x->val.type = LVAL_SYM;
+  x->val.ref = LVAL_IMMORTAL;
+  x->val.sym = x->name;
+  lsym.slots[i] = x;
+  lsym.count++;
+  return x->name;
+}
+
+unsigned lsym_hash(const char *sym) { return lsym_entry_of(sym)->hash; }
+
+lval *lsym_lval(const char *sym) { return &lsym_entry_of(sym)->val; }
+
+void lsym_set_cached(const char *sym, unsigned long version) {
+  lsym_entry_of(sym)->cached = (unsigned)version;
+}
+
+int lsym_cached(const char *sym, unsigned long version) {
+  return lsym_entry_of(sym)->cached == (unsigned)version;
+}
+
+void lsym_quit(void) {
+  for (int i = 0; i < lsym.cap; i++) {
+    free(lsym.slots[i]);
+  }
+  free(lsym.slots);
+  memset(&lsym, 0, sizeof lsym);
+}
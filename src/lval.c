@@ -2,21 +2,53 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "local-include/lcode.h"
 #include "local-include/lenv.h"
+#include "local-include/lgc.h"
+#include "local-include/lmem.h"
+#include "local-include/lopt.h"
+#include "local-include/lstats.h"
+#include "local-include/lsym.h"
 #include "local-include/lval.h"
 #include <clisp.h>
 #include <mpc.h>
 
+/* The shared small integers, set up on first use. */
+static lval lval_small[LVAL_SMALL_MAX - LVAL_SMALL_MIN + 1];
+
+static lval *lval_new(int type) {
+  lval *v = lgc_alloc();
+  v->type = type;
+  v->ref = 1;
+  int k = LSTATS_KIND(type);
+  lstats.made[k]++;
+  lstats.live[k]++;
+  if (++lstats.live_total > lstats.peak) {
+    lstats.peak = lstats.live_total;
+  }
+  return v;
+}
+
 lval *lval_num(long x) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_NUM;
+  if (x >= LVAL_SMALL_MIN && x <= LVAL_SMALL_MAX) {
+    lval *v = &lval_small[x - LVAL_SMALL_MIN];
+    if (!v->ref) {
+      v->type = LVAL_NUM;
+      v->ref = LVAL_IMMORTAL;
+      v->num = x;
+    }
+    v->ref++;
+    lstats.shared++;
+    return v;
+  }
+
+  lval *v = lval_new(LVAL_NUM);
   v->num = x;
   return v;
 }
 
 lval *lval_err(char *fmt, ...) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_ERR;
+  lval *v = lval_new(LVAL_ERR);
 
   va_list va;
   va_start(va, fmt);
@@ -33,57 +65,247 @@ lval *lval_err(char *fmt, ...) {
 }
 
 lval *lval_sym(char *s) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_SYM;
-  v->sym = malloc(strlen(s) + 1);
-  strcpy(v->sym, s);
-  return v;
+  lstats.shared++;
+  return lval_copy(lsym_lval(lsym_intern(s)));
+}
+
+lval *lval_sym_n(const char *s, size_t n) {
+  lstats.shared++;
+  return lval_copy(lsym_lval(lsym_intern_n(s, n)));
 }
 
 lval *lval_str(char *s) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_STR;
+  lval *v = lval_new(LVAL_STR);
   v->str = malloc(strlen(s) + 1);
   strcpy(v->str, s);
   return v;
 }
 
+lval *lval_str_n(const char *s, size_t n) {
+  lval *v = lval_new(LVAL_STR);
+  v->str = malloc(n + 1);
+  memcpy(v->str, s, n);
+  v->str[n] = '\0';
+  return v;
+}
+
 lval *lval_sexpr(void) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_SEXPR;
+  lval *v = lval_new(LVAL_SEXPR);
   v->count = 0;
+  v->cap = 0;
+  v->off = 0;
+  v->hash = 0;
   v->cell = NULL;
+  v->base = NULL;
+  lgc_track(v);
   return v;
 }
 
 lval *lval_qexpr(void) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_QEXPR;
+  lval *v = lval_new(LVAL_QEXPR);
   v->count = 0;
+  v->cap = 0;
+  v->off = 0;
+  v->hash = 0;
   v->cell = NULL;
+  v->base = NULL;
+  lgc_track(v);
+  return v;
+}
+
+lval *lval_vec(int len) {
+  lval *v = lval_new(LVAL_VEC);
+  v->len = len;
+  v->vec = len ? malloc(sizeof(long) * len) : NULL;
   return v;
 }
 
 lval *lval_fun(lbuiltin func) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_FUN;
+  lval *v = lval_new(LVAL_FUN);
   v->builtin = func;
+  v->fast = NULL;
   return v;
 }
 
-lval *lval_lambda(lval *formals, lval *body) {
-  lval *v = malloc(sizeof(lval));
-  v->type = LVAL_FUN;
+lval *lval_lambda(lenv *e, lval *formals, lval *body) {
+  lval *v = lval_new(LVAL_FUN);
   v->builtin = NULL;
-  v->env = lenv_new();
+  v->env = NULL;
   v->formals = formals;
   v->body = body;
+  v->code = lcode_compile(e, formals, body);
+  lopt_check(e, formals, body);
+  lgc_track(v);
+  return v;
+}
+
+/* Move the cells of `v` into a new array of `cap` slots, `off` of them free
+ * before the first cell. */
+static void lval_move(lval *v, int cap, int off) {
+  lval **cell = lmem_alloc(sizeof(lval *) * cap);
+  lstats.cells++;
+  lstats.cell_bytes += sizeof(lval *) * cap;
+  if (v->count) {
+    memcpy(cell + off, v->cell, sizeof(lval *) * v->count);
+  }
+  if (v->cap) {
+    lmem_free(v->cell - v->off, sizeof(lval *) * v->cap);
+  }
+  v->cell = cell + off;
+  v->cap = cap;
+  v->off = off;
+}
+
+static int lval_grown(lval *v) { return v->count < 2 ? 4 : v->count * 2; }
+
+void lval_reserve(lval *v, int n) {
+  if (v->cap - v->off < n) {
+    int cap = lval_grown(v);
+    lval_move(v, n > cap ? n : cap, 0);
+  }
+}
+
+void lval_clear(lval *v) {
+  if (v->base) {
+    lval_del(v->base);
+  } else {
+    for (int i = 0; i < v->count; i++) {
+      lval_del(v->cell[i]);
+    }
+    if (v->cap) {
+      lmem_free(v->cell - v->off, sizeof(lval *) * v->cap);
+    }
+  }
+  v->count = 0;
+  v->cap = 0;
+  v->off = 0;
+  v->hash = 0;
+  v->cell = NULL;
+  v->base = NULL;
+}
+
+static lval *lval_view(lval *b, lval **cell, int count, int type) {
+  lval *v = lval_new(type);
+  v->count = count;
+  v->cap = 0;
+  v->off = 0;
+  v->hash = 0;
+  v->cell = cell;
+  v->base = lval_copy(b);
+  lgc_track(v);
   return v;
 }
 
+/* Hand the cells of a shared list over to a hidden base, so that views of it
+ * can be taken. Readers of `v` see the same cells at the same address. */
+static void lval_share(lval *v) {
+  lval *b = lval_qexpr();
+  b->count = v->count;
+  b->cap = v->cap;
+  b->off = v->off;
+  b->cell = v->cell;
+  v->cap = 0;
+  v->off = 0;
+  v->base = b;
+}
+
+/* Turn the view `v`, which nobody else holds, back into a list owning its
+ * cells. The base's array is taken over when `v` is its only view. */
+static void lval_own(lval *v) {
+  lval *b = v->base;
+  if (b->ref == 1) {
+    for (lval **c = b->cell; c < v->cell; c++) {
+      lval_del(*c);
+    }
+    for (lval **c = v->cell + v->count; c < b->cell + b->count; c++) {
+      lval_del(*c);
+    }
+    v->cap = b->cap;
+    v->off = v->cell - (b->cell - b->off);
+    b->count = 0;
+    b->cap = 0;
+  } else {
+    lval **cell = lmem_alloc(sizeof(lval *) * v->count);
+    for (int i = 0; i < v->count; i++) {
+      cell[i] = lval_copy(v->cell[i]);
+    }
+    v->cell = cell;
+    v->cap = v->count;
+    v->off = 0;
+  }
+  v->base = NULL;
+  lval_del(b);
+}
+
+/*
+ * Extend `v` over `front` unused slots before it and `back` after it in the
+ * array of its base, returning the extended list with the new slots left for
+ * the caller to fill. Only the view that reaches the edge of what the base
+ * has handed out may extend it, so no other view ever sees the new cells.
+ * Returns NULL, leaving `v` alone, when that is not possible.
+ */
+static lval *lval_claim(lval *v, int front, int back) {
+  if (v->ref > 1 && !v->base && v->count) {
+    lval_share(v);
+  }
+  lval *b = v->base;
+  if (!b) {
+    return NULL;
+  }
+  if (front && (v->cell != b->cell || b->off < front)) {
+    return NULL;
+  }
+  if (back && (v->cell + v->count != b->cell + b->count ||
+               b->cap - b->off - b->count < back)) {
+    return NULL;
+  }
+
+  lval *x = v;
+  if (v->ref > 1) {
+    x = lval_view(b, v->cell, v->count, v->type);
+    lval_del(v);
+  }
+  b->cell -= front;
+  b->off -= front;
+  b->count += front + back;
+  x->cell -= front;
+  x->count += front + back;
+  x->hash = 0;
+  return x;
+}
+
 lval *lval_join(lval *x, lval *y) {
-  while (y->count) {
-    x = lval_add(x, lval_pop(y, 0));
+  /* A short list is joined onto a long one through the room in its front. */
+  if (y->ref == 1 && !y->base && y->count > x->count) {
+    for (int i = x->count - 1; i >= 0; i--) {
+      y = lval_add_front(y, lval_copy(x->cell[i]));
+    }
+    y->type = x->type;
+    lval_del(x);
+    return y;
+  }
+
+  lval *z = y->count ? lval_claim(x, 0, y->count) : NULL;
+  if (z) {
+    for (int i = 0; i < y->count; i++) {
+      z->cell[z->count - y->count + i] = lval_copy(y->cell[i]);
+    }
+    lval_del(y);
+    return z;
+  }
+
+  x = lval_mut(x);
+  lval_reserve(x, x->count + y->count);
+  if (y->ref == 1 && !y->base) {
+    if (y->count) {
+      memcpy(x->cell + x->count, y->cell, sizeof(lval *) * y->count);
+    }
+    x->count += y->count;
+    y->count = 0;
+  } else {
+    for (int i = 0; i < y->count; i++) {
+      x->cell[x->count++] = lval_copy(y->cell[i]);
+    }
   }
 
   lval_del(y);
@@ -91,18 +313,38 @@ lval *lval_join(lval *x, lval *y) {
 }
 
 lval *lval_copy(lval *v) {
-  lval *x = malloc(sizeof(lval));
-  x->type = v->type;
+  lstats.copies++;
+  v->ref++;
+  return v;
+}
+
+lval *lval_mut(lval *v) {
+  if (v->ref == 1) {
+    /* The caller is about to change `v`, so its hash is stale. */
+    if (v->type == LVAL_SEXPR || v->type == LVAL_QEXPR) {
+      v->hash = 0;
+      if (v->base) {
+        lval_own(v);
+      }
+    }
+    return v;
+  }
+
+  lval *x = lval_new(v->type);
+  lstats.clones++;
+  lstats.clone_bytes += sizeof(lval);
 
   switch (v->type) {
   case LVAL_FUN:
     if (v->builtin) {
       x->builtin = v->builtin;
+      x->fast = v->fast;
     } else {
       x->builtin = NULL;
-      x->env = lenv_copy(v->env);
+      x->env = v->env ? lenv_share(v->env) : NULL;
       x->formals = lval_copy(v->formals);
       x->body = lval_copy(v->body);
+      x->code = lcode_copy(v->code);
     }
     break;
   case LVAL_NUM:
@@ -111,29 +353,50 @@ lval *lval_copy(lval *v) {
   case LVAL_ERR:
     x->err = malloc(strlen(v->err) + 1);
     strcpy(x->err, v->err);
+    lstats.clone_bytes += strlen(v->err) + 1;
     break;
   case LVAL_SYM:
-    x->sym = malloc(strlen(v->sym) + 1);
-    strcpy(x->sym, v->sym);
+    x->sym = v->sym;
     break;
   case LVAL_STR:
     x->str = malloc(strlen(v->str) + 1);
     strcpy(x->str, v->str);
+    lstats.clone_bytes += strlen(v->str) + 1;
+    break;
+  case LVAL_VEC:
+    x->len = v->len;
+    x->vec = v->len ? malloc(sizeof(long) * v->len) : NULL;
+    if (v->len) {
+      memcpy(x->vec, v->vec, sizeof(long) * v->len);
+    }
+    lstats.clone_bytes += sizeof(long) * v->len;
     break;
   case LVAL_SEXPR:
   case LVAL_QEXPR:
     x->count = v->count;
-    x->cell = malloc(sizeof(lval *) * x->count);
+    x->cap = v->count;
+    x->off = 0;
+    x->hash = 0;
+    x->base = NULL;
+    x->cell = lmem_alloc(sizeof(lval *) * x->count);
+    lstats.cells++;
+    lstats.cell_bytes += sizeof(lval *) * x->count;
+    lstats.clone_bytes += sizeof(lval *) * x->count;
     for (int i = 0; i < x->count; i++) {
       x->cell[i] = lval_copy(v->cell[i]);
     }
     break;
   }
 
+  lgc_track(x);
+  v->ref--;
   return x;
 }
 
 int lval_eq(lval *x, lval *y) {
+  if (x == y) {
+    return 1;
+  }
   if (x->type != y->type) {
     return 0;
   }
@@ -143,9 +406,12 @@ int lval_eq(lval *x, lval *y) {
   case LVAL_ERR:
     return (strcmp(x->err, y->err) == 0);
   case LVAL_SYM:
-    return (strcmp(x->sym, y->sym) == 0);
+    return (x->sym == y->sym);
   case LVAL_STR:
     return (strcmp(x->str, y->str) == 0);
+  case LVAL_VEC:
+    return x->len == y->len &&
+           (!x->len || memcmp(x->vec, y->vec, sizeof(long) * x->len) == 0);
   case LVAL_FUN:
     if (x->builtin || y->builtin) {
       return x->builtin == y->builtin;
@@ -154,7 +420,8 @@ int lval_eq(lval *x, lval *y) {
     }
   case LVAL_QEXPR:
   case LVAL_SEXPR:
-    if (x->count != y->count) {
+    /* Lists that were hashed before can tell a difference without a walk. */
+    if (x->count != y->count || (x->hash && y->hash && x->hash != y->hash)) {
       return 0;
     }
     for (int i = 0; i < x->count; i++) {
@@ -169,6 +436,10 @@ int lval_eq(lval *x, lval *y) {
 }
 
 void lval_del(lval *v) {
+  if (--v->ref > 0) {
+    return;
+  }
+
   switch (v->type) {
   case LVAL_NUM:
     break;
@@ -176,28 +447,92 @@ void lval_del(lval *v) {
     free(v->err);
     break;
   case LVAL_SYM:
-    free(v->sym);
     break;
   case LVAL_STR:
     free(v->str);
     break;
+  case LVAL_VEC:
+    free(v->vec);
+    break;
   case LVAL_SEXPR:
   case LVAL_QEXPR:
-    for (int i = 0; i < v->count; i++) {
-      lval_del(v->cell[i]);
-    }
-    free(v->cell);
+    lval_clear(v);
     break;
   case LVAL_FUN:
     if (!v->builtin) {
-      lenv_del(v->env);
+      if (v->env) {
+        lenv_del(v->env);
+      }
       lval_del(v->formals);
       lval_del(v->body);
+      lcode_del(v->code);
     }
     break;
   }
 
-  free(v);
+  lstats.live[LSTATS_KIND(v->type)]--;
+  lstats.live_total--;
+  lgc_free(v);
+}
+
+static unsigned long lval_mix(unsigned long h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdUL;
+  h ^= h >> 33;
+  return h;
+}
+
+static unsigned long lval_hash_str(const char *s) {
+  unsigned long h = 14695981039346656037UL;
+  for (; *s; s++) {
+    h = (h ^ (unsigned char)*s) * 1099511628211UL;
+  }
+  return h;
+}
+
+unsigned long lval_hash(lval *v) {
+  unsigned long h = 0;
+  switch (v->type) {
+  case LVAL_NUM:
+    h = v->num;
+    break;
+  case LVAL_ERR:
+    h = lval_hash_str(v->err);
+    break;
+  case LVAL_SYM:
+    h = lsym_hash(v->sym);
+    break;
+  case LVAL_STR:
+    h = lval_hash_str(v->str);
+    break;
+  case LVAL_VEC:
+    h = v->len;
+    for (int i = 0; i < v->len; i++) {
+      h = lval_mix(h ^ v->vec[i]);
+    }
+    break;
+  case LVAL_FUN:
+    if (v->builtin) {
+      h = (unsigned long)v->builtin;
+    } else {
+      h = lval_mix(lval_hash(v->formals)) ^ lval_hash(v->body);
+    }
+    break;
+  case LVAL_SEXPR:
+  case LVAL_QEXPR:
+    if (v->hash) {
+      return v->hash;
+    }
+    h = v->count;
+    for (int i = 0; i < v->count; i++) {
+      h = lval_mix(h ^ lval_hash(v->cell[i]));
+    }
+    /* Folded to what the cache holds, never 0, so both always agree. */
+    h = lval_mix(h ^ v->type);
+    v->hash = (unsigned)(h ^ h >> 32) | 1;
+    return v->hash;
+  }
+  return lval_mix(h ^ (unsigned long)v->type << 56);
 }
 
 lval *lval_read_num(mpc_ast_t *t) {
@@ -216,20 +551,71 @@ lval *lval_read_str(mpc_ast_t *t) {
   return str;
 }
 
+lval *lval_slice(lval *v, int i, int n) {
+  if (n == 0) {
+    lval *x = v->type == LVAL_SEXPR ? lval_sexpr() : lval_qexpr();
+    lval_del(v);
+    return x;
+  }
+  if (v->ref == 1 && !v->base) {
+    for (int k = 0; k < i; k++) {
+      lval_del(v->cell[k]);
+    }
+    for (int k = i + n; k < v->count; k++) {
+      lval_del(v->cell[k]);
+    }
+    v->cell += i;
+    v->off += i;
+    v->count = n;
+    v->hash = 0;
+    return v;
+  }
+  if (v->ref == 1) {
+    v->cell += i;
+    v->count = n;
+    v->hash = 0;
+    return v;
+  }
+
+  if (!v->base) {
+    lval_share(v);
+  }
+  lval *x = lval_view(v->base, v->cell + i, n, v->type);
+  lval_del(v);
+  return x;
+}
+
 lval *lval_add(lval *v, lval *x) {
-  v->count++;
-  v->cell = realloc(v->cell, sizeof(lval *) * v->count);
-  v->cell[v->count - 1] = x;
+  lval *y = lval_claim(v, 0, 1);
+  if (y) {
+    y->cell[y->count - 1] = x;
+    return y;
+  }
+
+  v = lval_mut(v);
+  if (v->off + v->count == v->cap) {
+    lval_move(v, lval_grown(v), 0);
+  }
+  v->cell[v->count++] = x;
   return v;
 }
 
 lval *lval_add_front(lval *v, lval *x) {
-  v->count++;
-  v->cell = realloc(v->cell, sizeof(lval *) * v->count);
-  for (int i = v->count - 1; i > 0; i--) {
-    v->cell[i] = v->cell[i - 1];
+  lval *y = lval_claim(v, 1, 0);
+  if (y) {
+    y->cell[0] = x;
+    return y;
+  }
+
+  v = lval_mut(v);
+  if (v->off == 0) {
+    int cap = lval_grown(v);
+    lval_move(v, cap, (cap - v->count + 1) / 2);
   }
+  v->cell--;
+  v->off--;
   v->cell[0] = x;
+  v->count++;
   return v;
 }
 
@@ -0,0 +1,325 @@
+#include "local-include/lvec.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LVEC_X86
+#include <immintrin.h>
+#endif
+
+/* Arithmetic wraps, so it is done on unsigned longs. */
+typedef unsigned long lword;
+
+static struct {
+  const char *isa;
+  void (*add)(long *, const long *, const long *, int);
+  void (*mul)(long *, const long *, const long *, int);
+  long (*dot)(const long *, const long *, int);
+  long (*sum)(const long *, int);
+  long (*min)(const long *, int);
+  long (*max)(const long *, int);
+  void (*scan)(long *, const long *, int);
+} lvec;
+
+/* Scalar kernels; the vector ones fall back to these for their tails. */
+static void lvec_add_scalar(long *r, const long *a, const long *b, int n) {
+  for (int i = 0; i < n; i++) {
+    r[i] = (lword)a[i] + (lword)b[i];
+  }
+}
+
+static void lvec_mul_scalar(long *r, const long *a, const long *b, int n) {
+  for (int i = 0; i < n; i++) {
+    r[i] = (lword)a[i] * (lword)b[i];
+  }
+}
+
+static long lvec_dot_scalar(const long *a, const long *b, int n) {
+  lword s = 0;
+  for (int i = 0; i < n; i++) {
+    s += (lword)a[i] * (lword)b[i];
+  }
+  return s;
+}
+
+static long lvec_sum_scalar(const long *a, int n) {
+  lword s = 0;
+  for (int i = 0; i < n; i++) {
+    s += a[i];
+  }
+  return s;
+}
+
+static long lvec_min_scalar(const long *a, int n) {
+  long m = a[0];
+  for (int i = 1; i < n; i++) {
+    m = a[i] < m ? a[i] : m;
+  }
+  return m;
+}
+
+static long lvec_max_scalar(const long *a, int n) {
+  long m = a[0];
+  for (int i = 1; i < n; i++) {
+    m = a[i] > m ? a[i] : m;
+  }
+  return m;
+}
+
+static void lvec_scan_scalar(long *r, const long *a, int n) {
+  lword s = 0;
+  for (int i = 0; i < n; i++) {
+    s += a[i];
+    r[i] = s;
+  }
+}
+
+#ifdef LVEC_X86
+/* SSE2 has no 64-bit multiply; build it from 32x32->64 products. */
+static __m128i lvec_mul_epi64_sse2(__m128i a, __m128i b) {
+  __m128i lo = _mm_mul_epu32(a, b);
+  __m128i hi = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+                             _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+  return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+}
+
+static long lvec_hsum_sse2(__m128i s) {
+  long x[2];
+  _mm_storeu_si128((__m128i *)x, s);
+  return (lword)x[0] + (lword)x[1];
+}
+
+static void lvec_add_sse2(long *r, const long *a, const long *b, int n) {
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    _mm_storeu_si128((__m128i *)(r + i), _mm_add_epi64(x, y));
+  }
+  lvec_add_scalar(r + i, a + i, b + i, n - i);
+}
+
+static void lvec_mul_sse2(long *r, const long *a, const long *b, int n) {
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    _mm_storeu_si128((__m128i *)(r + i), lvec_mul_epi64_sse2(x, y));
+  }
+  lvec_mul_scalar(r + i, a + i, b + i, n - i);
+}
+
+static long lvec_dot_sse2(const long *a, const long *b, int n) {
+  __m128i s = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    s = _mm_add_epi64(s, lvec_mul_epi64_sse2(x, y));
+  }
+  return (lword)lvec_hsum_sse2(s) + (lword)lvec_dot_scalar(a + i, b + i, n - i);
+}
+
+static long lvec_sum_sse2(const long *a, int n) {
+  __m128i s0 = _mm_setzero_si128();
+  __m128i s1 = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 = _mm_add_epi64(s0, _mm_loadu_si128((const __m128i *)(a + i)));
+    s1 = _mm_add_epi64(s1, _mm_loadu_si128((const __m128i *)(a + i + 2)));
+  }
+  return (lword)lvec_hsum_sse2(_mm_add_epi64(s0, s1)) +
+         (lword)lvec_sum_scalar(a + i, n - i);
+}
+
+/* Two lanes at a time: add each lane's left neighbour, then the carry. */
+static void lvec_scan_sse2(long *r, const long *a, int n) {
+  __m128i carry = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi64(x, carry);
+    _mm_storeu_si128((__m128i *)(r + i), x);
+    carry = _mm_shuffle_epi32(x, 0xEE);
+  }
+  if (i < n) {
+    r[i] = (lword)a[i] + (lword)_mm_cvtsi128_si64(carry);
+  }
+}
+
+__attribute__((target("avx2"))) static __m256i
+lvec_mul_epi64_avx2(__m256i a, __m256i b) {
+  __m256i lo = _mm256_mul_epu32(a, b);
+  __m256i hi =
+      _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                       _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+}
+
+__attribute__((target("avx2"))) static long lvec_hsum_avx2(__m256i s) {
+  __m128i x = _mm_add_epi64(_mm256_castsi256_si128(s),
+                            _mm256_extracti128_si256(s, 1));
+  return lvec_hsum_sse2(x);
+}
+
+__attribute__((target("avx2"))) static void
+lvec_add_avx2(long *r, const long *a, const long *b, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    _mm256_storeu_si256((__m256i *)(r + i), _mm256_add_epi64(x, y));
+  }
+  lvec_add_scalar(r + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+lvec_mul_avx2(long *r, const long *a, const long *b, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    _mm256_storeu_si256((__m256i *)(r + i), lvec_mul_epi64_avx2(x, y));
+  }
+  lvec_mul_scalar(r + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static long lvec_dot_avx2(const long *a,
+                                                          const long *b,
+                                                          int n) {
+  __m256i s = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    s = _mm256_add_epi64(s, lvec_mul_epi64_avx2(x, y));
+  }
+  return (lword)lvec_hsum_avx2(s) + (lword)lvec_dot_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) static long lvec_sum_avx2(const long *a,
+                                                          int n) {
+  __m256i s0 = _mm256_setzero_si256();
+  __m256i s1 = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i *)(a + i)));
+    s1 = _mm256_add_epi64(s1,
+                          _mm256_loadu_si256((const __m256i *)(a + i + 4)));
+  }
+  return (lword)lvec_hsum_avx2(_mm256_add_epi64(s0, s1)) +
+         (lword)lvec_sum_scalar(a + i, n - i);
+}
+
+/* SSE2 has no 64-bit compare, so only AVX2 gets vector min/max. */
+__attribute__((target("avx2"))) static long lvec_min_avx2(const long *a,
+                                                          int n) {
+  if (n < 4) {
+    return lvec_min_scalar(a, n);
+  }
+  __m256i m = _mm256_loadu_si256((const __m256i *)a);
+  int i = 4;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    m = _mm256_blendv_epi8(m, x, _mm256_cmpgt_epi64(m, x));
+  }
+  long x[4];
+  _mm256_storeu_si256((__m256i *)x, m);
+  long r = lvec_min_scalar(x, 4);
+  for (; i < n; i++) {
+    r = a[i] < r ? a[i] : r;
+  }
+  return r;
+}
+
+__attribute__((target("avx2"))) static long lvec_max_avx2(const long *a,
+                                                          int n) {
+  if (n < 4) {
+    return lvec_max_scalar(a, n);
+  }
+  __m256i m = _mm256_loadu_si256((const __m256i *)a);
+  int i = 4;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    m = _mm256_blendv_epi8(m, x, _mm256_cmpgt_epi64(x, m));
+  }
+  long x[4];
+  _mm256_storeu_si256((__m256i *)x, m);
+  long r = lvec_max_scalar(x, 4);
+  for (; i < n; i++) {
+    r = a[i] > r ? a[i] : r;
+  }
+  return r;
+}
+#endif
+
+static void lvec_init(void) {
+  lvec.isa = "scalar";
+  lvec.add = lvec_add_scalar;
+  lvec.mul = lvec_mul_scalar;
+  lvec.dot = lvec_dot_scalar;
+  lvec.sum = lvec_sum_scalar;
+  lvec.min = lvec_min_scalar;
+  lvec.max = lvec_max_scalar;
+  lvec.scan = lvec_scan_scalar;
+#ifdef LVEC_X86
+  /* SSE2 is part of x86-64 itself. */
+  lvec.isa = "sse2";
+  lvec.add = lvec_add_sse2;
+  lvec.mul = lvec_mul_sse2;
+  lvec.dot = lvec_dot_sse2;
+  lvec.sum = lvec_sum_sse2;
+  lvec.scan = lvec_scan_sse2;
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    lvec.isa = "avx2";
+    lvec.add = lvec_add_avx2;
+    lvec.mul = lvec_mul_avx2;
+    lvec.dot = lvec_dot_avx2;
+    lvec.sum = lvec_sum_avx2;
+    lvec.min = lvec_min_avx2;
+    lvec.max = lvec_max_avx2;
+  }
+#endif
+}
+
+const char *lvec_isa(void) {
+  if (!lvec.isa) {
+    lvec_init();
+  }
+  return lvec.isa;
+}
+
+void lvec_add(long *r, const long *a, const long *b, int n) {
+  lvec_isa();
+  lvec.add(r, a, b, n);
+}
+
+void lvec_mul(long *r, const long *a, const long *b, int n) {
+  lvec_isa();
+  lvec.mul(r, a, b, n);
+}
+
+long lvec_dot(const long *a, const long *b, int n) {
+  lvec_isa();
+  return lvec.dot(a, b, n);
+}
+
+long lvec_sum(const long *a, int n) {
+  lvec_isa();
+  return lvec.sum(a, n);
+}
+
+long lvec_min(const long *a, int n) {
+  lvec_isa();
+  return lvec.min(a, n);
+}
+
+long lvec_max(const long *a, int n) {
+  lvec_isa();
+  return lvec.max(a, n);
+}
+
+void lvec_scan(long *r, const long *a, int n) {
+  lvec_isa();
+  lvec.scan(r, a, n);
+}
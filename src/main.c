@@ -13,6 +13,30 @@ int main(int argc, char **argv) {
   puts("Press Ctrl+d to Exit\n");
   signal(SIGINT, SIG_IGN);
 
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--gc") == 0) {
+      lgc_enable();
+    }
+    if (strcmp(argv[i], "--reader=mpc") == 0) {
+      parse_validate();
+    }
+    if (strcmp(argv[i], "--no-opt") == 0) {
+      lopt_disable();
+    }
+    if (strcmp(argv[i], "--dump-opt") == 0) {
+      lopt_dump();
+    }
+    if (strcmp(argv[i], "--profile") == 0) {
+      lprof_start(0);
+    }
+    if (strcmp(argv[i], "--profile=sample") == 0) {
+      lprof_start(1);
+    }
+    if (strncmp(argv[i], "--profile-out=", 14) == 0) {
+      lprof_output(argv[i] + 14);
+    }
+  }
+
   parser_init();
   lenv *e = lenv_new();
   lenv_add_builtins(e);
@@ -23,23 +47,23 @@ int main(int argc, char **argv) {
   while ((input = readline("lispy> "))) {
     add_history(input);
 
-    mpc_result_t r;
-    if (parse_line(input, &r)) {
-      // parse_print(&r);
-      lval *x = lval_eval(e, lval_read(r.output));
-      // lenv_print(e);
-      lval_println(x);
-      lval_del(x);
-      parse_delete(&r);
-    } else {
-      parse_error(&r);
-    }
+    lval *x = lval_eval(e, parse_read("<stdin>", input));
+    lval_println(x);
+    lval_del(x);
+    lmem_reset();
 
     free(input);
   }
-  lenv_del(e);
   putchar('\n');
+  lprof_report();
+  lenv_del(e);
+  lgc_report();
+  lstats_report();
 
   parser_quit();
+  lenv_quit();
+  lstack_quit();
+  lsym_quit();
+  lmem_quit();
   return 0;
 }
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "local-include/lenv.h"
+#include "local-include/lread.h"
 #include "local-include/lval.h"
 #include <clisp.h>
 #include <mpc.h>
@@ -16,6 +17,8 @@ mpc_parser_t *Qexpr = NULL;
 mpc_parser_t *Expr = NULL;
 mpc_parser_t *Lispy = NULL;
 
+static int validate = 0;
+
 void parser_init(void) {
   Number = mpc_new("number");
   Symbol = mpc_new("symbol");
@@ -54,9 +57,104 @@ void parse_error(mpc_result_t *r) {
   mpc_err_delete(r->error);
 }
 
+void parse_validate(void) { validate = 1; }
+
+static lval *parse_mpc(const char *name, const char *s) {
+  mpc_result_t r;
+  if (!mpc_parse(name, s, Lispy, &r)) {
+    char *msg = mpc_err_string(r.error);
+    mpc_err_delete(r.error);
+    msg[strcspn(msg, "\n")] = '\0';
+    lval *err = lval_err("%s", msg);
+    free(msg);
+    return err;
+  }
+  lval *x = lval_read(r.output);
+  mpc_ast_delete(r.output);
+  return x;
+}
+
+lval *parse_read(const char *name, const char *s) {
+  lval *x = lread_all(name, s, strlen(s));
+  if (!validate) {
+    return x;
+  }
+
+  lval *y = parse_mpc(name, s);
+  if ((x->type == LVAL_ERR) != (y->type == LVAL_ERR) ||
+      (y->type != LVAL_ERR && !lval_eq(x, y))) {
+    fprintf(stderr, "reader: %s: result differs from mpc\n", name);
+  }
+  lval_del(x);
+  return y;
+}
+
+lval *parse_file(const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if (!f) {
+    return lval_err("%s: error: Unable to open file!", filename);
+  }
+
+  size_t len = 0;
+  size_t cap = 4096;
+  char *buf = malloc(cap);
+  size_t n;
+  while ((n = fread(buf + len, 1, cap - len - 1, f)) > 0) {
+    len += n;
+    if (cap - len == 1) {
+      cap *= 2;
+      buf = realloc(buf, cap);
+    }
+  }
+  fclose(f);
+  buf[len] = '\0';
+
+  lval *x = parse_read(filename, buf);
+  free(buf);
+  return x;
+}
+
+static void parse_eval(lenv *e, lval *x) {
+  x = lval_eval(e, x);
+  /* If Evaluation leads to error print it */
+  if (x->type == LVAL_ERR) {
+    lval_println(x);
+  }
+  lval_del(x);
+  lmem_reset();
+}
+
+lval *parse_load(lenv *e, const char *filename) {
+  if (validate) {
+    lval *expr = parse_file(filename);
+    if (expr->type == LVAL_ERR) {
+      return expr;
+    }
+    while (expr->count) {
+      parse_eval(e, lval_pop(expr, 0));
+    }
+    lval_del(expr);
+    return lval_sexpr();
+  }
+
+  lreader r;
+  if (!lread_open(&r, filename)) {
+    return lval_err("%s: error: Unable to open file!", filename);
+  }
+  lval *x;
+  while ((x = lread_next(&r)) && x->type != LVAL_ERR) {
+    parse_eval(e, x);
+  }
+  lread_close(&r);
+  return x ? x : lval_sexpr();
+}
+
 void parse_args(int argc, char **argv, lenv *e) {
   if (argc >= 2) {
     for (int i = 1; i < argc; i++) {
+      if (strncmp(argv[i], "--", 2) == 0) {
+        continue;
+      }
       lval *args = lval_add(lval_sexpr(), lval_str(argv[i]));
       lval *x = builtin_load(e, args);
       if (x->type == LVAL_ERR) {